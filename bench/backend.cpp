@@ -0,0 +1,129 @@
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include <fabrik_chain.hpp>
+#include <fabrik_glm.hpp>
+#include <fabrik_precision.hpp>
+#include <fabrik_raylib.hpp>
+
+// THE SAME CHAIN ON EVERY MATH BACKEND. THE SOLVE ITSELF HAS NO TRIG SINCE
+// THE ROTATIONS ARE UNIT COMPLEX NUMBERS, SO EACH FRAME ALSO READS BACK EVERY
+// BONE ANGLE THE WAY A RENDERER WOULD, WHICH IS WHERE THE atan2 CALLS ARE.
+
+static uint32_t gSeed = 12345;
+static float Random(float min, float max)
+{
+    gSeed = gSeed*1103515245u+12345u;
+    return min+(max-min)*((gSeed>>8)&0xFFFF)/65535.f;
+}
+
+// THE ANGLES END UP HERE SO THE READBACK CANNOT BE OPTIMIZED AWAY
+static volatile float gSink;
+
+template<uint32_t N, class P>
+static double Run(bool constrained, const std::vector<FabrikVec2>& targets, double& error)
+{
+    typedef typename P::Vector V;
+    typedef typename P::Scalar S;
+
+    FabrikChain<N, FabrikLimited, P> chain;
+    std::array<V, N+1> joints;
+    gSeed = 54321;
+    for(uint32_t i = 0; i <= N; i++)
+    {
+        joints[i] = V{P::FromFloat(10.f*i), P::FromFloat(i > 0 ? Random(-2, 2) : 0)};
+    }
+    chain.SetJoints(joints);
+    if(constrained)
+    {
+        for(uint32_t b = 2; b <= N; b++)
+        {
+            chain.SetMinTheta(b, P::FromFloat(-40));
+            chain.SetMaxTheta(b, P::FromFloat(40));
+        }
+    }
+    chain.SetThreshold(P::FromFloat(0.5f));
+    chain.SetIterationThreshold(P::FromFloat(0.01f));
+    chain.SetIterationLimit(20);
+
+    std::vector<V> converted(targets.size());
+    for(uint32_t t = 0; t < targets.size(); t++)
+    {
+        converted[t] = V{P::FromFloat(targets[t].x), P::FromFloat(targets[t].y)};
+    }
+
+    S angles = S(0);
+    error = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(uint32_t t = 0; t < converted.size(); t++)
+    {
+        chain.Solve(N, converted[t]);
+        for(uint32_t b = 1; b <= N; b++)
+        {
+            angles += chain.GetTheta(b);
+        }
+        error += P::ToFloat(P::Distance(chain.GetBoneStart(N), converted[t]));
+    }
+    auto end = std::chrono::steady_clock::now();
+    gSink = P::ToFloat(angles);
+    error /= targets.size();
+    return std::chrono::duration<double, std::nano>(end-start).count()/targets.size();
+}
+
+template<uint32_t N>
+static void Compare(bool constrained)
+{
+    std::vector<FabrikVec2> targets(200000);
+    for(FabrikVec2& target : targets)
+    {
+        float radius = Random(0, 10.f*N);
+        float angle = Random(-3.14159265f, 3.14159265f);
+        target = FabrikVec2{radius*cosf(angle), radius*sinf(angle)};
+    }
+
+    const char* names[] = {"raylib", "float", "glm", "glm simd"};
+    double baseline = 0;
+    for(int backend = 0; backend < 4; backend++)
+    {
+        double time;
+        double error;
+        if(backend == 0)
+        {
+            time = Run<N, FabrikRaylib>(constrained, targets, error);
+            baseline = time;
+        }
+        else if(backend == 1)
+        {
+            time = Run<N, FabrikFloat>(constrained, targets, error);
+        }
+        else if(backend == 2)
+        {
+            time = Run<N, FabrikGlm>(constrained, targets, error);
+        }
+        else
+        {
+#if GLM_CONFIG_SIMD == GLM_ENABLE && (GLM_ARCH & GLM_ARCH_SSE2_BIT)
+            time = Run<N, FabrikGlmSimd>(constrained, targets, error);
+#else
+            continue;
+#endif
+        }
+        printf("bones %2u %-13s %-8s %8.1f ns/frame  x%.2f  mean distance to target %.4f\n", N,
+            constrained ? "constrained" : "unconstrained", names[backend], time, baseline/time, error);
+    }
+}
+
+int main()
+{
+    for(bool constrained : {false, true})
+    {
+        Compare<3>(constrained);
+        Compare<8>(constrained);
+        Compare<32>(constrained);
+    }
+    return 0;
+}
@@ -0,0 +1,183 @@
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include <fabrik.hpp>
+#include <fabrik_batch.hpp>
+
+static uint32_t gSeed = 12345;
+static float Random(float min, float max)
+{
+    gSeed = gSeed*1103515245u+12345u;
+    return min+(max-min)*((gSeed>>8)&0xFFFF)/65535.f;
+}
+
+static std::vector<FabrikPD2D> MakeChains(uint32_t count, uint32_t bones, bool constrained)
+{
+    std::vector<FabrikPD2D> chains(count);
+    for(uint32_t c = 0; c < count; c++)
+    {
+        FabrikPD2D& chain = chains[c];
+        chain.AddRoot({0, 0}, {10, 0});
+        for(uint32_t b = 2; b <= bones; b++)
+        {
+            chain.AddBone({10.f*b, Random(-2, 2)});
+        }
+        if(constrained)
+        {
+            for(uint32_t b = 2; b <= bones; b++)
+            {
+                chain.SetMinTheta(b, -40);
+                chain.SetMaxTheta(b, 40);
+            }
+        }
+        chain.SetThreshold(0.5f);
+        chain.SetIterationThreshold(0.01f);
+        chain.SetIterationLimit(20);
+    }
+    return chains;
+}
+
+static double Run(std::vector<FabrikPD2D>& chains, FabrikBatch::Isa isa, const std::vector<FabrikVec2>& targets, uint32_t frames, uint32_t effector)
+{
+    FabrikBatch batch;
+    for(FabrikPD2D& chain : chains)
+    {
+        batch.AddChain(&chain);
+    }
+    batch.SetIsa(isa);
+
+    auto start = std::chrono::steady_clock::now();
+    for(uint32_t f = 0; f < frames; f++)
+    {
+        batch.Solve(effector, targets.data()+f*chains.size(), chains.size());
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end-start).count()/(double(frames)*chains.size());
+}
+
+// WHAT-IF QUERIES ON ONE CHAIN, NS PER CANDIDATE. isa < 0 COPIES THE CHAIN AND
+// SOLVES IT FOR EACH CANDIDATE, THE WAY IT WAS DONE BEFORE EvaluateTargets.
+static double Query(FabrikPD2D& chain, int isa, const std::vector<FabrikVec2>& candidates, uint32_t effector,
+    std::vector<FabrikPD2D::TargetResult>& results)
+{
+    const uint32_t rounds = 10;
+    auto start = std::chrono::steady_clock::now();
+    if(isa < 0)
+    {
+        for(uint32_t r = 0; r < rounds; r++)
+        {
+            for(uint32_t c = 0; c < candidates.size(); c++)
+            {
+                FabrikPD2D copy = chain;
+                copy.Solve({effector}, {candidates[c]}, {false});
+                results[c].mError = FabrikFloat::Distance(copy.GetBoneStart(effector), candidates[c]);
+            }
+        }
+    }
+    else
+    {
+        FabrikBatch batch;
+        batch.SetIsa((FabrikBatch::Isa)isa);
+        for(uint32_t r = 0; r < rounds; r++)
+        {
+            batch.EvaluateTargets(chain, effector, candidates.data(), candidates.size(), results.data());
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end-start).count()/(double(rounds)*candidates.size());
+}
+
+int main()
+{
+    const uint32_t count = 4096;
+    const uint32_t frames = 20;
+    const char* names[] = {"scalar", "sse", "avx2"};
+
+    printf("supported: %s\n", names[FabrikBatch::GetSupportedIsa()]);
+    for(uint32_t bones : {4u, 16u, 64u})
+    {
+        for(bool constrained : {false, true})
+        {
+            std::vector<FabrikPD2D> chains = MakeChains(count, bones, constrained);
+            std::vector<FabrikVec2> targets(frames*count);
+            for(FabrikVec2& target : targets)
+            {
+                float radius = Random(0, 10.f*bones);
+                float angle = Random(-3.14159265f, 3.14159265f);
+                target = FabrikVec2{radius*cosf(angle), radius*sinf(angle)};
+            }
+
+            double scalarTime = 0;
+            std::vector<FabrikPD2D> reference;
+            for(int isa = FabrikBatch::ISA_SCALAR; isa <= FabrikBatch::GetSupportedIsa(); isa++)
+            {
+                std::vector<FabrikPD2D> copy = chains;
+                double time = Run(copy, (FabrikBatch::Isa)isa, targets, frames, bones);
+
+                float error = 0;
+                if(isa == FabrikBatch::ISA_SCALAR)
+                {
+                    scalarTime = time;
+                    reference = copy;
+                }
+                else
+                {
+                    for(uint32_t c = 0; c < count; c++)
+                    {
+                        for(uint32_t b = 1; b <= bones; b++)
+                        {
+                            error = fmaxf(error, FabrikFloat::Distance(copy[c].GetBoneEnd(b), reference[c].GetBoneEnd(b)));
+                        }
+                    }
+                }
+                printf("bones %3u %-13s %-6s %9.1f ns/solve  x%.2f  max deviation %g\n", bones,
+                    constrained ? "constrained" : "unconstrained", names[isa], time, scalarTime/time, error);
+            }
+        }
+    }
+
+    // A PLANNER SCORING GRAB POINTS, A THIRD OF THEM BEYOND THE CHAIN
+    const uint32_t candidateCount = 1024;
+    for(uint32_t bones : {4u, 16u, 64u})
+    {
+        for(bool constrained : {false, true})
+        {
+            FabrikPD2D chain = MakeChains(1, bones, constrained)[0];
+            std::vector<FabrikVec2> candidates(candidateCount);
+            for(FabrikVec2& candidate : candidates)
+            {
+                float radius = Random(0, 15.f*bones);
+                float angle = Random(-3.14159265f, 3.14159265f);
+                candidate = FabrikVec2{radius*cosf(angle), radius*sinf(angle)};
+            }
+
+            std::vector<FabrikPD2D::TargetResult> reference(candidateCount);
+            double copyTime = Query(chain, -1, candidates, bones, reference);
+            printf("query bones %3u %-13s %-6s %9.1f ns/candidate\n", bones, constrained ? "constrained" : "unconstrained", "copy", copyTime);
+            for(int isa = FabrikBatch::ISA_SCALAR; isa <= FabrikBatch::GetSupportedIsa(); isa++)
+            {
+                std::vector<FabrikPD2D::TargetResult> results(candidateCount);
+                double time = Query(chain, isa, candidates, bones, results);
+
+                // REJECTED CANDIDATES ONLY BOUND THE ERROR FROM BELOW
+                uint32_t rejected = 0;
+                float error = 0;
+                for(uint32_t c = 0; c < candidateCount; c++)
+                {
+                    if(results[c].mRejected)
+                    {
+                        ++rejected;
+                        continue;
+                    }
+                    error = fmaxf(error, fabsf(results[c].mError-reference[c].mError));
+                }
+                printf("query bones %3u %-13s %-6s %9.1f ns/candidate  x%.2f  rejected %u  max deviation %g\n", bones,
+                    constrained ? "constrained" : "unconstrained", names[isa], time, copyTime/time, rejected, error);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include <fabrik.hpp>
+#include <fabrik_scan.hpp>
+
+static uint32_t gSeed = 12345;
+static float Random(float min, float max)
+{
+    gSeed = gSeed*1103515245u+12345u;
+    return min+(max-min)*((gSeed>>8)&0xFFFF)/65535.f;
+}
+
+// A ROPE: SHORT BONES, EACH SLIGHTLY BENT FROM ITS PARENT
+static FabrikPD2D MakeRope(uint32_t bones)
+{
+    gSeed = 12345;
+    std::vector<FabrikVec2> joints(bones+1);
+    float angle = 0;
+    joints[0] = FabrikVec2{0, 0};
+    for(uint32_t j = 1; j <= bones; j++)
+    {
+        angle += Random(-0.05f, 0.05f);
+        joints[j] = joints[j-1]+FabrikVec2{cosf(angle), sinf(angle)};
+    }
+    FabrikPD2D rope;
+    rope.BuildChain(joints.data(), joints.size());
+    return rope;
+}
+
+// NS PER BONE FOR A FULL SWEEP: TURNING THE FIRST BONE DIRTIES THEM ALL
+static double Run(FabrikPD2D& rope, uint32_t frames)
+{
+    uint32_t bones = rope.GetBoneCount();
+    auto start = std::chrono::steady_clock::now();
+    for(uint32_t f = 0; f < frames; f++)
+    {
+        rope.SetTheta(1, 0.1f*f);
+        rope.GetBoneEnd(bones);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end-start).count()/(double(frames)*bones);
+}
+
+int main()
+{
+    uint32_t hardware = std::thread::hardware_concurrency();
+    printf("hardware threads: %u\n", hardware);
+
+    for(uint32_t bones : {1000u, 10000u, 100000u})
+    {
+        uint32_t frames = 10000000/bones;
+        FabrikPD2D serial = MakeRope(bones);
+        double serialTime = Run(serial, frames);
+        printf("bones %6u serial    %6.2f ns/bone\n", bones, serialTime);
+
+        for(uint32_t threads : {1u, 2u, 4u, 8u})
+        {
+            FabrikScan scan;
+            scan.SetThreads(threads);
+            FabrikPD2D rope = MakeRope(bones);
+            rope.SetScan(&scan);
+            double time = Run(rope, frames);
+
+            // THE SAME POSE AS THE SERIAL ROPE AFTER THE LAST FRAME
+            float error = 0;
+            for(uint32_t b = 1; b <= bones; b++)
+            {
+                error = fmaxf(error, FabrikFloat::Distance(rope.GetBoneEnd(b), serial.GetBoneEnd(b)));
+            }
+            printf("bones %6u threads %u %6.2f ns/bone  x%.2f  max deviation %g\n", bones, threads, time, serialTime/time, error);
+        }
+    }
+    return 0;
+}
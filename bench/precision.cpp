@@ -0,0 +1,144 @@
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include <fabrik_chain.hpp>
+#include <fabrik_precision.hpp>
+
+static uint32_t gSeed = 12345;
+static float Random(float min, float max)
+{
+    gSeed = gSeed*1103515245u+12345u;
+    return min+(max-min)*((gSeed>>8)&0xFFFF)/65535.f;
+}
+
+// THE SAME RIG IN EVERY PRECISION, BUILT FROM THE SAME float INPUTS. N == 0
+// SIZES THE CHAIN AT RUNTIME.
+template<uint32_t N, class P>
+static FabrikChain<N, FabrikLimited, P> MakeChain(const std::vector<FabrikVec2>& joints, bool constrained)
+{
+    typedef typename P::Vector V;
+
+    uint32_t bones = joints.size()-1;
+    FabrikChain<N, FabrikLimited, P> chain(bones);
+    std::vector<V> converted(bones+1);
+    for(uint32_t i = 0; i <= bones; i++)
+    {
+        converted[i] = V{P::FromFloat(joints[i].x), P::FromFloat(joints[i].y)};
+    }
+    chain.SetJoints(converted.data());
+    if(constrained)
+    {
+        for(uint32_t b = 2; b <= bones; b++)
+        {
+            chain.SetMinTheta(b, P::FromFloat(-40));
+            chain.SetMaxTheta(b, P::FromFloat(40));
+        }
+    }
+    chain.SetThreshold(P::FromFloat(0.5f));
+    chain.SetIterationThreshold(P::FromFloat(0.01f));
+    chain.SetIterationLimit(20);
+    return chain;
+}
+
+// SOLVES EVERY TARGET IN TURN, RETURNS ns PER SOLVE AND THE EFFECTOR OF EVERY FRAME
+template<uint32_t N, class P>
+static double Run(const std::vector<FabrikVec2>& joints, bool constrained, const std::vector<FabrikVec2>& targets, std::vector<FabrikVec2>& effectors)
+{
+    typedef typename P::Vector V;
+
+    FabrikChain<N, FabrikLimited, P> chain = MakeChain<N, P>(joints, constrained);
+    std::vector<V> converted(targets.size());
+    for(uint32_t t = 0; t < targets.size(); t++)
+    {
+        converted[t] = V{P::FromFloat(targets[t].x), P::FromFloat(targets[t].y)};
+    }
+
+    std::vector<V> solved(targets.size());
+    auto start = std::chrono::steady_clock::now();
+    for(uint32_t t = 0; t < converted.size(); t++)
+    {
+        chain.Solve(chain.GetBoneCount(), converted[t]);
+        solved[t] = chain.GetBoneStart(chain.GetBoneCount());
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    effectors.resize(targets.size());
+    for(uint32_t t = 0; t < targets.size(); t++)
+    {
+        effectors[t] = FabrikVec2{P::ToFloat(solved[t].x), P::ToFloat(solved[t].y)};
+    }
+    return std::chrono::duration<double, std::nano>(end-start).count()/targets.size();
+}
+
+template<uint32_t N>
+static void Compare(bool constrained, uint32_t bones = N)
+{
+    std::vector<FabrikVec2> joints(bones+1);
+    joints[0] = FabrikVec2{0, 0};
+    for(uint32_t b = 1; b <= bones; b++)
+    {
+        joints[b] = FabrikVec2{10.f*b, Random(-2, 2)};
+    }
+
+    std::vector<FabrikVec2> targets(bones > 32 ? 20000 : 200000);
+    for(FabrikVec2& target : targets)
+    {
+        float radius = Random(0, 10.f*bones);
+        float angle = Random(-3.14159265f, 3.14159265f);
+        target = FabrikVec2{radius*cosf(angle), radius*sinf(angle)};
+    }
+
+    // EVERY SOLVE STARTS FROM THE LAST POSE, SO THE MODES DRIFT APART OVER A
+    // RUN: COMPARE HOW CLOSE EACH GETS TO ITS TARGETS INSTEAD OF TO EACH OTHER
+    const char* names[] = {"float", "double", "fixed"};
+    double baseline = 0;
+    for(int mode = 0; mode < 3; mode++)
+    {
+        std::vector<FabrikVec2> effectors;
+        double time;
+        if(mode == 0)
+        {
+            time = Run<N, FabrikFloat>(joints, constrained, targets, effectors);
+            baseline = time;
+        }
+        else if(mode == 1)
+        {
+            time = Run<N, FabrikDouble>(joints, constrained, targets, effectors);
+        }
+        else
+        {
+            time = Run<N, FabrikFixed>(joints, constrained, targets, effectors);
+        }
+
+        double error = 0;
+        for(uint32_t t = 0; t < targets.size(); t++)
+        {
+            error += FabrikFloat::Distance(effectors[t], targets[t]);
+        }
+        printf("bones %3u %-13s %-6s %8.1f ns/solve  x%.2f  mean distance to target %.4f\n", bones,
+            constrained ? "constrained" : "unconstrained", names[mode], time, baseline/time, error/targets.size());
+    }
+}
+
+int main()
+{
+    for(bool constrained : {false, true})
+    {
+        Compare<3>(constrained);
+        Compare<8>(constrained);
+        Compare<32>(constrained);
+    }
+
+    // LONG CHAINS FOR OFFLINE BAKING, SIZED AT RUNTIME
+    printf("runtime sized\n");
+    for(bool constrained : {false, true})
+    {
+        Compare<0>(constrained, 32);
+        Compare<0>(constrained, 256);
+    }
+    return 0;
+}
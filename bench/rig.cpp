@@ -0,0 +1,172 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include <fabrik_rig.hpp>
+
+// LOADING A LEVEL'S RIGS: BONE BY BONE THROUGH THE API, FROM JSON, AND
+// FROM A MAPPED PACK. THEN SPAWNING LONG ROPES WITH AddBone AND BuildChain,
+// AND A CROWD OF ONE RIG AS FULL COPIES OR AS INSTANCES OF ONE DEFINITION.
+
+static uint32_t gSeed = 12345;
+static float Random(float min, float max)
+{
+    gSeed = gSeed*1103515245u+12345u;
+    return min+(max-min)*((gSeed>>8)&0xFFFF)/65535.f;
+}
+
+static void Build(FabrikPD2D& rig, uint32_t bones)
+{
+    rig.AddRoot({0, 0}, {10, 0});
+    for(uint32_t b = 2; b <= bones; b++)
+    {
+        rig.AddBone({10.f*b, Random(-2, 2)});
+        rig.SetMinTheta(b, -30);
+        rig.SetMaxTheta(b, 30);
+    }
+}
+
+static double Milliseconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-start).count();
+}
+
+int main()
+{
+    const char* path = "bench_rig.frig";
+    const uint32_t counts[] = {1000, 10000, 50000};
+    const uint32_t bones = 16;
+    for(uint32_t count : counts)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<FabrikPD2D> built(count);
+        for(FabrikPD2D& rig : built)
+        {
+            Build(rig, bones);
+        }
+        double api = Milliseconds(start);
+
+        std::string text;
+        FabrikRigJson::Write(built, text);
+        std::vector<uint8_t> pack;
+        FabrikRigPack::Write(built, pack);
+        FILE* file = fopen(path, "wb");
+        if(file == nullptr || fwrite(pack.data(), 1, pack.size(), file) != pack.size())
+        {
+            fprintf(stderr, "cannot write %s\n", path);
+            return 1;
+        }
+        fclose(file);
+
+        start = std::chrono::steady_clock::now();
+        std::vector<FabrikPD2D> parsed;
+        std::string error;
+        FabrikRigJson::Read(text.data(), text.size(), parsed, error);
+        double json = Milliseconds(start);
+
+        start = std::chrono::steady_clock::now();
+        FabrikRigFile mapped;
+        mapped.Open(path);
+        std::vector<FabrikPD2D> loaded(mapped.GetPack().GetRigCount());
+        for(uint32_t r = 0; r < loaded.size(); r++)
+        {
+            mapped.GetPack().GetRig(r).Load(loaded[r]);
+        }
+        double binary = Milliseconds(start);
+
+        printf("%6u rigs of %u bones  api %8.2f ms  json %8.2f ms (%zu KB)  pack %8.2f ms (%zu KB)  x%.1f\n", count, bones,
+            api, json, text.size()/1024, binary, pack.size()/1024, api/binary);
+    }
+    remove(path);
+
+    const uint32_t segments[] = {100, 5000, 100000};
+    for(uint32_t count : segments)
+    {
+        std::vector<FabrikVec2> joints(count+1);
+        for(uint32_t j = 0; j <= count; j++)
+        {
+            joints[j] = FabrikVec2{2.f*j, Random(-0.5f, 0.5f)};
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        FabrikPD2D added;
+        added.AddRoot(joints[0], joints[1]);
+        for(uint32_t j = 2; j <= count; j++)
+        {
+            added.AddBone(joints[j]);
+        }
+        double api = Milliseconds(start);
+
+        start = std::chrono::steady_clock::now();
+        FabrikPD2D built;
+        built.BuildChain(joints.data(), joints.size());
+        double bulk = Milliseconds(start);
+
+        printf("rope of %6u segments  AddBone %8.3f ms  BuildChain %8.3f ms  x%.1f\n", count, api, bulk, api/bulk);
+    }
+
+    std::vector<FabrikPD2D> prototype(1);
+    Build(prototype[0], bones);
+    std::vector<uint8_t> pack;
+    FabrikRigPack::Write(prototype, pack);
+    FabrikRigPack opened;
+    opened.Open(pack.data(), pack.size());
+    FabrikRigImage image = opened.GetRig(0);
+
+    const uint32_t crowds[] = {1000, 10000};
+    for(uint32_t count : crowds)
+    {
+        std::vector<FabrikVec2> targets(count);
+        for(FabrikVec2& target : targets)
+        {
+            target = FabrikVec2{Random(40, 140), Random(-60, 60)};
+        }
+
+        // FULL COPIES PAY FOR THEIR OWN BONES
+        auto start = std::chrono::steady_clock::now();
+        std::vector<FabrikPD2D> copies(count);
+        for(FabrikPD2D& rig : copies)
+        {
+            image.Load(rig);
+        }
+        double copyLoad = Milliseconds(start);
+        start = std::chrono::steady_clock::now();
+        for(uint32_t c = 0; c < count; c++)
+        {
+            copies[c].Solve({bones}, {targets[c]}, {false});
+        }
+        double copySolve = Milliseconds(start);
+        size_t copyBytes = 0;
+        for(FabrikPD2D& rig : copies)
+        {
+            copyBytes += rig.GetMemoryUsage()+rig.GetDefinition()->GetMemoryUsage();
+        }
+
+        start = std::chrono::steady_clock::now();
+        std::shared_ptr<const FabrikPD2D::Definition> definition = image.LoadDefinition();
+        std::vector<FabrikPD2D> instances;
+        instances.reserve(count);
+        for(uint32_t c = 0; c < count; c++)
+        {
+            instances.emplace_back(definition);
+        }
+        double instanceLoad = Milliseconds(start);
+        start = std::chrono::steady_clock::now();
+        for(uint32_t c = 0; c < count; c++)
+        {
+            instances[c].Solve({bones}, {targets[c]}, {false});
+        }
+        double instanceSolve = Milliseconds(start);
+        size_t instanceBytes = definition->GetMemoryUsage();
+        for(FabrikPD2D& rig : instances)
+        {
+            instanceBytes += rig.GetMemoryUsage();
+        }
+
+        printf("crowd of %5u  copies %7.2f ms load %7.2f ms solve %5zu B/rig  instances %7.2f ms load %7.2f ms solve %5zu B/rig\n",
+            count, copyLoad, copySolve, copyBytes/count, instanceLoad, instanceSolve, instanceBytes/count);
+    }
+    return 0;
+}
@@ -0,0 +1,319 @@
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include <rapidjson/filewritestream.h>
+#include <rapidjson/prettywriter.h>
+
+#include <fabrik.hpp>
+
+// HEADLESS SOLVE BENCHMARK. WRITES ONE JSON RECORD PER CASE TO THE FILE GIVEN
+// AS THE FIRST ARGUMENT, OR TO stdout, SO RUNS CAN BE DIFFED BETWEEN RELEASES.
+
+// EVERY HEAP ALLOCATION IN THE PROCESS, A STEADY STATE SOLVE SHOULD MAKE NONE
+static uint64_t gAllocations = 0;
+
+void* operator new(size_t size)
+{
+    ++gAllocations;
+    void* memory = malloc(size > 0 ? size : 1);
+    if(memory == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    free(memory);
+}
+
+static uint32_t gSeed = 12345;
+static float Random(float min, float max)
+{
+    gSeed = gSeed*1103515245u+12345u;
+    return min+(max-min)*((gSeed>>8)&0xFFFF)/65535.f;
+}
+
+class Case
+{
+    public:
+
+    uint32_t mBones;
+    uint32_t mEffectors;
+    bool mConstrained;
+    bool mReachable;
+    bool mMoving;
+    bool mTail; // THE EFFECTORS STOP AT THE MIDDLE, THE REST IS A TAIL NOBODY READS
+    bool mPositions; // CANONICAL_POSITIONS, NO ANGLE IS READ BETWEEN SOLVES
+};
+
+class Result
+{
+    public:
+
+    uint32_t mSolves;
+    double mNanoseconds; // PER SOLVE
+    double mIterations; // PER SOLVE, SUMMED OVER THE EFFECTORS
+    double mError; // MEAN OVER THE EFFECTORS OF THE LAST SOLVE
+    uint64_t mAllocations; // DURING THE TIMED SOLVES
+    uint32_t mScratchAllocations;
+};
+
+static void MakeRig(const Case& c, FabrikPD2D& rig, FabrikPD2D::EffectorSet& effectors)
+{
+    const float length = 10;
+    rig.AddRoot({0, 0}, {length, 0});
+    for(uint32_t b = 2; b <= c.mBones; b++)
+    {
+        rig.AddBone({length*b, Random(-2, 2)});
+    }
+    if(c.mConstrained)
+    {
+        for(uint32_t b = 2; b <= c.mBones; b++)
+        {
+            rig.SetMinTheta(b, -30);
+            rig.SetMaxTheta(b, 30);
+        }
+    }
+    rig.SetThreshold(0.5f);
+    rig.SetIterationThreshold(0.01f);
+    rig.SetIterationLimit(20);
+    if(c.mPositions)
+    {
+        rig.SetCanonical(FabrikPD2D::CANONICAL_POSITIONS);
+    }
+
+    // EVENLY SPACED, THE LAST ON THE LAST BONE (OR THE MIDDLE ONE FOR A
+    // TAIL). PINS ALONG THE WAY ARE fixed.
+    uint32_t last = c.mTail ? c.mBones/2 : c.mBones;
+    for(uint32_t e = 1; e <= c.mEffectors; e++)
+    {
+        uint32_t bone = 1+(last-1)*e/c.mEffectors;
+        effectors.Add(bone, e < c.mEffectors);
+    }
+}
+
+// TARGETS FOR EVERY FRAME, frame*effectors+effector
+static std::vector<FabrikVec2> MakeTargets(const Case& c, FabrikPD2D& rig, FabrikPD2D::EffectorSet& effectors, uint32_t frames)
+{
+    std::vector<FabrikVec2> targets(frames*c.mEffectors);
+    for(uint32_t e = 0; e < c.mEffectors; e++)
+    {
+        // DISTANCE FROM THE BASE ALONG THE CHAIN TO THE EFFECTOR
+        uint32_t bone = effectors.GetBone(e);
+        float reach = 0;
+        for(uint32_t b = 1; b < bone; b++)
+        {
+            reach += rig.GetLength(b);
+        }
+        float radius = c.mReachable ? 0.7f*reach : 1.5f*reach+10;
+        float angle = Random(-3.14159265f, 3.14159265f);
+        for(uint32_t f = 0; f < frames; f++)
+        {
+            float a = c.mMoving ? angle+0.02f*f : angle;
+            targets[f*c.mEffectors+e] = FabrikVec2{radius*cosf(a), radius*sinf(a)};
+        }
+    }
+    return targets;
+}
+
+static Result Run(const Case& c)
+{
+    Result result;
+    result.mSolves = c.mBones*c.mEffectors < 10 ? 100000 : 1000000/(c.mBones*c.mEffectors);
+    if(result.mSolves < 20)
+    {
+        result.mSolves = 20;
+    }
+
+    FabrikPD2D rig;
+    FabrikPD2D::EffectorSet effectors;
+    MakeRig(c, rig, effectors);
+    std::vector<FabrikVec2> targets = MakeTargets(c, rig, effectors, result.mSolves);
+
+    // ONE WARM UP SOLVE SIZES THE SCRATCH AND THE SET, AS A GAME'S FIRST FRAME WOULD
+    rig.Solve(effectors, targets.data(), c.mEffectors);
+
+    uint64_t allocations = gAllocations;
+    uint32_t scratchAllocations = rig.GetScratchAllocations();
+    auto start = std::chrono::steady_clock::now();
+    for(uint32_t f = 0; f < result.mSolves; f++)
+    {
+        rig.Solve(effectors, targets.data()+f*c.mEffectors, c.mEffectors);
+    }
+    auto end = std::chrono::steady_clock::now();
+    result.mNanoseconds = std::chrono::duration<double, std::nano>(end-start).count()/result.mSolves;
+    result.mAllocations = gAllocations-allocations;
+    result.mScratchAllocations = rig.GetScratchAllocations()-scratchAllocations;
+
+    // THE SAME RUN AGAIN WITH STATS ON FOR THE ITERATIONS, THE TIMER WOULD SKEW THE TIMING
+    FabrikPD2D counted;
+    FabrikPD2D::EffectorSet countedEffectors;
+    gSeed = 12345;
+    MakeRig(c, counted, countedEffectors);
+    counted.SetCollectStats(true);
+    counted.Solve(countedEffectors, targets.data(), c.mEffectors);
+
+    uint64_t iterations = 0;
+    for(uint32_t f = 0; f < result.mSolves; f++)
+    {
+        counted.Solve(countedEffectors, targets.data()+f*c.mEffectors, c.mEffectors);
+        for(const FabrikPD2D::SolveStats::Effector& effector : counted.GetLastStats().mEffectors)
+        {
+            iterations += effector.mIterations;
+        }
+    }
+    result.mIterations = (double)iterations/result.mSolves;
+
+    result.mError = 0;
+    for(uint32_t e = 0; e < c.mEffectors; e++)
+    {
+        result.mError += effectors.GetError(e)/c.mEffectors;
+    }
+    return result;
+}
+
+static void Record(const Case& c, rapidjson::PrettyWriter<rapidjson::FileWriteStream>& writer)
+{
+    gSeed = 12345;
+    Result r = Run(c);
+
+    writer.StartObject();
+    writer.Key("bones");
+    writer.Uint(c.mBones);
+    writer.Key("effectors");
+    writer.Uint(c.mEffectors);
+    writer.Key("constrained");
+    writer.Bool(c.mConstrained);
+    writer.Key("reachable");
+    writer.Bool(c.mReachable);
+    writer.Key("moving");
+    writer.Bool(c.mMoving);
+    writer.Key("tail");
+    writer.Bool(c.mTail);
+    writer.Key("positions");
+    writer.Bool(c.mPositions);
+    writer.Key("solves");
+    writer.Uint(r.mSolves);
+    writer.Key("ns_per_solve");
+    writer.Double(r.mNanoseconds);
+    writer.Key("iterations_per_solve");
+    writer.Double(r.mIterations);
+    writer.Key("mean_error");
+    writer.Double(r.mError);
+    writer.Key("allocations");
+    writer.Uint64(r.mAllocations);
+    writer.Key("scratch_allocations");
+    writer.Uint(r.mScratchAllocations);
+    writer.EndObject();
+
+    fprintf(stderr, "bones %5u effectors %u %-13s %-11s %-6s %-4s %-9s %12.1f ns/solve %6.2f iterations\n", c.mBones, c.mEffectors,
+        c.mConstrained ? "constrained" : "unconstrained", c.mReachable ? "reachable" : "unreachable", c.mMoving ? "moving" : "static",
+        c.mTail ? "tail" : "", c.mPositions ? "positions" : "", r.mNanoseconds, r.mIterations);
+}
+
+int main(int argc, char** argv)
+{
+    FILE* file = argc > 1 ? fopen(argv[1], "wb") : stdout;
+    if(file == nullptr)
+    {
+        fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    char buffer[65536];
+    rapidjson::FileWriteStream stream(file, buffer, sizeof(buffer));
+    rapidjson::PrettyWriter<rapidjson::FileWriteStream> writer(stream);
+
+    writer.StartObject();
+    writer.Key("benchmark");
+    writer.String("solve");
+    writer.Key("results");
+    writer.StartArray();
+
+    const uint32_t bones[] = {2, 3, 10, 100, 1000, 10000};
+    const uint32_t effectors[] = {1, 2, 5};
+    for(uint32_t b : bones)
+    {
+        for(uint32_t e : effectors)
+        {
+            // EFFECTORS NEED DISTINCT BONES
+            if(e > b-1)
+            {
+                continue;
+            }
+            for(int flags = 0; flags < 8; flags++)
+            {
+                Case c;
+                c.mBones = b;
+                c.mEffectors = e;
+                c.mConstrained = flags & 1;
+                c.mReachable = flags & 2;
+                c.mMoving = flags & 4;
+                c.mTail = false;
+                c.mPositions = false;
+
+                Record(c, writer);
+            }
+        }
+    }
+
+    // ONE EFFECTOR HALF WAY DOWN A LONG CHAIN, THE BONES AFTER IT ONLY FOLLOW
+    const uint32_t tails[] = {100, 1000, 10000};
+    for(uint32_t b : tails)
+    {
+        for(int flags = 0; flags < 4; flags++)
+        {
+            Case c;
+            c.mBones = b;
+            c.mEffectors = 1;
+            c.mConstrained = flags & 1;
+            c.mReachable = flags & 2;
+            c.mMoving = true;
+            c.mTail = true;
+            c.mPositions = false;
+            Record(c, writer);
+        }
+    }
+
+    // THE SAME CHAINS AS ABOVE KEEPING ONLY THE JOINTS, FOR CALLERS THAT
+    // NEVER ASK FOR AN ANGLE
+    const uint32_t positions[] = {10, 100, 1000};
+    for(uint32_t b : positions)
+    {
+        for(int flags = 0; flags < 4; flags++)
+        {
+            Case c;
+            c.mBones = b;
+            c.mEffectors = 1;
+            c.mConstrained = flags & 1;
+            c.mReachable = flags & 2;
+            c.mMoving = true;
+            c.mTail = false;
+            c.mPositions = true;
+            Record(c, writer);
+        }
+    }
+
+    writer.EndArray();
+    writer.EndObject();
+    stream.Flush();
+    fputc('\n', file);
+
+    if(file != stdout)
+    {
+        fclose(file);
+    }
+    return 0;
+}
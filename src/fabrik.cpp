@@ -1,106 +1,420 @@
 #include "fabrik.hpp"
+#include "fabrik_limit.hpp"
+#include "fabrik_reach.hpp"
+#include "fabrik_scan.hpp"
 
-#include "raylib/raylib.h"
-#include "raylib/raymath.h"
-
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
 #include <cstdio>
-#include <map>
 #include <vector>
 
-FabrikPD2D::Bone::Bone()
-    : mID(0), mLength(0), mTheta(0), mMinTheta(-180), mMaxTheta(180), mPrev(0), mNext(0)
+FabrikPD2D::Scratch::Scratch()
+    : mPositions(), mPositionsRemain(), mTargets(), mSums(), mCounts(), mFlags(), mAllocations(0)
+{
+}
+
+void FabrikPD2D::Scratch::Reserve(uint32_t joints, bool multiEnd)
 {
+    if(mPositions.size() >= joints && (!multiEnd || mTargets.size() >= joints))
+    {
+        return;
+    }
+    // GROW GEOMETRICALLY SO BUILDING A CHAIN BONE BY BONE STAYS CHEAP
+    uint32_t size = mPositions.size() > 0 ? mPositions.size() : 8;
+    while(size < joints)
+    {
+        size *= 2;
+    }
+    mPositions.resize(size);
+    mPositionsRemain.resize(size);
+    if(multiEnd)
+    {
+        mTargets.resize(size);
+        mSums.resize(size);
+        mCounts.resize(size);
+        mFlags.resize(size);
+    }
+    ++mAllocations;
 }
 
-FabrikPD2D::Bone::Bone(uint32_t id, float length, float theta, float minTheta, float maxTheta)
-    : mID(id), mLength(0), mTheta(), mMinTheta(minTheta), mMaxTheta(maxTheta),mPrev(0), mNext(0)
+size_t FabrikPD2D::Scratch::GetMemoryUsage() const
 {
+    return (mPositions.capacity()+mPositionsRemain.capacity()+mTargets.capacity()+mSums.capacity())*sizeof(FabrikVec2)
+        +mCounts.capacity()*sizeof(uint32_t)+mFlags.capacity()*sizeof(uint8_t);
 }
 
-FabrikPD2D::Bone::Bone(uint32_t id, float length, float theta, float minTheta, float maxTheta, uint32_t prev)
-    : mID(id), mLength(length), mTheta(theta), mMinTheta(minTheta), mMaxTheta(maxTheta), mPrev(prev), mNext(0)
+FabrikPD2D::EffectorSet::EffectorSet()
+    : mEntries(), mSorted(), mSolver(nullptr), mRevision(0)
 {
 }
 
+uint32_t FabrikPD2D::EffectorSet::Add(uint32_t bone, bool fixed)
+{
+    uint32_t pos = 0;
+    while(pos < mEntries.size() && mEntries[pos].mBone < bone)
+    {
+        ++pos;
+    }
+    if(pos < mEntries.size() && mEntries[pos].mBone == bone)
+    {
+        // ONLY A NEW FLAG CHANGES THE SEGMENTS, A REPEATED Add KEEPS THE POSE
+        if(mEntries[pos].mFixed != fixed)
+        {
+            mEntries[pos].mFixed = fixed;
+            mSolver = nullptr;
+        }
+        return mEntries[pos].mEffector;
+    }
+    mSolver = nullptr;
+
+    Entry entry;
+    entry.mBone = bone;
+    entry.mEffector = mSorted.size();
+    entry.mFixed = fixed;
+    entry.mTarget = FabrikVec2{0, 0};
+    entry.mLastTarget = FabrikVec2{0, 0};
+    entry.mLastError = 0;
+    mEntries.insert(mEntries.begin()+pos, entry);
+
+    mSorted.push_back(pos);
+    for(uint32_t i = pos; i < mEntries.size(); i++)
+    {
+        mSorted[mEntries[i].mEffector] = i;
+    }
+    return entry.mEffector;
+}
+
+void FabrikPD2D::EffectorSet::Clear()
+{
+    mEntries.clear();
+    mSorted.clear();
+    mSolver = nullptr;
+}
+
+uint32_t FabrikPD2D::EffectorSet::GetCount() const
+{
+    return mSorted.size();
+}
+
+uint32_t FabrikPD2D::EffectorSet::GetBone(uint32_t effector) const
+{
+    if(effector >= mSorted.size())
+    {
+        return 0;
+    }
+    return mEntries[mSorted[effector]].mBone;
+}
+
+bool FabrikPD2D::EffectorSet::GetFixed(uint32_t effector) const
+{
+    if(effector >= mSorted.size())
+    {
+        return false;
+    }
+    return mEntries[mSorted[effector]].mFixed;
+}
+
+void FabrikPD2D::EffectorSet::SetTarget(uint32_t effector, FabrikVec2 target)
+{
+    if(effector >= mSorted.size())
+    {
+        return;
+    }
+    mEntries[mSorted[effector]].mTarget = target;
+}
+
+FabrikVec2 FabrikPD2D::EffectorSet::GetTarget(uint32_t effector) const
+{
+    if(effector >= mSorted.size())
+    {
+        return FabrikVec2{0, 0};
+    }
+    return mEntries[mSorted[effector]].mTarget;
+}
+
+float FabrikPD2D::EffectorSet::GetError(uint32_t effector) const
+{
+    if(effector >= mSorted.size())
+    {
+        return 0;
+    }
+    return mEntries[mSorted[effector]].mLastError;
+}
+
+FabrikPD2D::Definition::Definition()
+    : mParents(1, 0), mChildren(1, 0), mSiblings(1, 0), mBranched(false), mLengths(1, 0), mLengthSums(1, 0), mLimits(1),
+      mRotations(1, FabrikVec2{1, 0}), mPreferMin(1, 1)
+{
+}
+
+uint32_t FabrikPD2D::Definition::GetBoneCount() const
+{
+    return mRotations.size()-1;
+}
+
+bool FabrikPD2D::Definition::IsBranched() const
+{
+    return mBranched;
+}
+
+size_t FabrikPD2D::Definition::GetMemoryUsage() const
+{
+    return sizeof(*this)+mParents.capacity()*sizeof(uint32_t)+mChildren.capacity()*sizeof(uint32_t)+mSiblings.capacity()*sizeof(uint32_t)
+        +mLengths.capacity()*sizeof(float)+mLengthSums.capacity()*sizeof(float)+mLimits.capacity()*sizeof(FabrikLimit)
+        +mRotations.capacity()*sizeof(FabrikVec2)+mPreferMin.capacity()*sizeof(uint8_t);
+}
+
 FabrikPD2D::FabrikPD2D()
-    : mBones(), mBasePosition{0, 0}, mBaseTheta(0), mIterationLimit(20), mIterationThreshold(0.1f), mThreshold(1.f)
+    : mDefinition(std::make_shared<Definition>()), mOwnsDefinition(true), mRotations(), mPreferMin(), mBasePosition{0, 0}, mBaseTheta(0), mBaseRotation{1, 0},
+      mRotationGlobalCache(), mJointCache(), mDirtyBone(0), mScan(nullptr), mTailBone(0), mTailEnd(0), mCanonical(CANONICAL_ROTATIONS), mStaleBone(0), mStaleEnd(0), mRevision(0), mScratch(), mIterationLimit(20), mIterationThreshold(0.1f), mThreshold(1.f),
+      mTargetEpsilon(0), mReachStats(), mStats(), mCollectStats(false)
+{
+    ResetPose();
+}
+
+FabrikPD2D::FabrikPD2D(std::shared_ptr<const Definition> definition)
+    : FabrikPD2D()
+{
+    if(definition != nullptr)
+    {
+        mDefinition = definition;
+        mOwnsDefinition = false;
+        ResetPose();
+    }
+}
+
+std::shared_ptr<const FabrikPD2D::Definition> FabrikPD2D::GetDefinition()
 {
-    mBones.push_back(Bone());
+    return mDefinition;
 }
 
-uint32_t FabrikPD2D::AddRoot(Vector2 start, Vector2 end)
+size_t FabrikPD2D::GetMemoryUsage()
 {
-    if(mBones.size() > 1)
+    size_t bytes = sizeof(*this)+mRotations.capacity()*sizeof(FabrikVec2)+mPreferMin.capacity()*sizeof(uint8_t)
+        +mRotationGlobalCache.capacity()*sizeof(FabrikVec2)+mJointCache.capacity()*sizeof(FabrikVec2)+mScratch.GetMemoryUsage();
+    bytes += mLegacyEffectors.mEntries.capacity()*sizeof(EffectorSet::Entry)+mLegacyEffectors.mSorted.capacity()*sizeof(uint32_t);
+    return bytes+mStats.mEffectors.capacity()*sizeof(SolveStats::Effector);
+}
+
+FabrikPD2D::Definition& FabrikPD2D::EditDefinition()
+{
+    if(!mOwnsDefinition || mDefinition.use_count() > 1)
+    {
+        mDefinition = std::make_shared<Definition>(*mDefinition);
+        mOwnsDefinition = true;
+    }
+    // NOT const_cast ON A const OBJECT: EVERY DEFINITION THIS RIG OWNS WAS CREATED MUTABLE ABOVE
+    return const_cast<Definition&>(*mDefinition);
+}
+
+uint32_t FabrikPD2D::AddRoot(FabrikVec2 start, FabrikVec2 end)
+{
+    if(mRotations.size() > 1)
     {
         return 0;
     }
 
     mBasePosition = start;
+    MarkDirty(0);
+    return AddChild(0, end);
+}
+
+uint32_t FabrikPD2D::AddBone(FabrikVec2 end)
+{
+    if(mRotations.size() <= 1)
+    {
+        return 0;
+    }
+    return AddChild(mRotations.size()-1, end);
+}
 
-    Bone bone;
-    bone.mID = mBones.size();
-    bone.mLength = Vector2Distance(start, end);
-    bone.mTheta = RAD2DEG*Vector2Angle(Vector2{1, 0}, Vector2Normalize(end-start))-mBaseTheta;
-    mBones.push_back(bone);
-    return bone.mID;
+uint32_t FabrikPD2D::AddBone(uint32_t parent, FabrikVec2 end)
+{
+    if(mRotations.size() <= 1 || parent >= mRotations.size())
+    {
+        return 0;
+    }
+    return AddChild(parent, end);
 }
 
-uint32_t FabrikPD2D::AddBone(Vector2 end)
+uint32_t FabrikPD2D::BuildChain(const FabrikVec2* joints, uint32_t count, const float* minThetas, const float* maxThetas)
 {
-    if(mBones.size() <= 1)
+    if(count < 2)
     {
         return 0;
     }
 
-    uint32_t last = mBones.back().mID;
+    // A NEW DEFINITION, THE OLD ONE MAY BE SHARED
+    std::shared_ptr<Definition> built = std::make_shared<Definition>();
+    Definition& definition = *built;
+    definition.mParents.reserve(count);
+    definition.mChildren.reserve(count);
+    definition.mSiblings.reserve(count);
+    definition.mLengths.reserve(count);
+    definition.mLengthSums.reserve(count);
+    definition.mLimits.reserve(count);
+    definition.mRotations.reserve(count);
+    definition.mPreferMin.reserve(count);
+    mRotationGlobalCache.resize(1);
+    mJointCache.resize(1);
+    mRotationGlobalCache.reserve(count);
+    mJointCache.reserve(count);
+
+    mBasePosition = joints[0];
+    mRotationGlobalCache[0] = mBaseRotation;
+    mJointCache[0] = mBasePosition;
+
+    // A NEW LIMIT COSTS THREE TRIG CALLS, COPY ONE INSTEAD
+    static const FabrikLimit freeLimit;
+
+    // THE FK CACHE IS FILLED ALONG THE WAY: EVERY BONE STARTS WHERE THE
+    // CACHE PUTS THE END OF THE LAST ONE, AS IN AddChild
+    for(uint32_t bone = 1; bone < count; bone++)
+    {
+        uint32_t parent = bone-1;
+        FabrikVec2 start = mJointCache[parent];
+        FabrikVec2 rotation = RotateByInverse(FabrikFloat::Normalize(joints[bone]-start), mRotationGlobalCache[parent]);
+        float length = FabrikFloat::Distance(start, joints[bone]);
 
-    Bone bone;
-    bone.mID = mBones.size();
+        FabrikLimit limit = freeLimit;
+        if(minThetas != nullptr || maxThetas != nullptr)
+        {
+            // AS SetMinTheta THEN SetMaxTheta
+            float minTheta = minThetas != nullptr ? minThetas[bone] : -180;
+            float maxTheta = maxThetas != nullptr ? maxThetas[bone] : 180;
+            minTheta = minTheta < -360 ? -360 : (minTheta > 360 ? 360 : minTheta);
+            maxTheta = maxTheta < -360 ? -360 : (maxTheta > 360 ? 360 : maxTheta);
+            if(limit.Unwrap(DegreesFromRotation(rotation)) < minTheta)
+            {
+                rotation = RotationFromDegrees(minTheta);
+            }
+            limit.Set(minTheta, limit.GetMaxTheta());
+            if(limit.Unwrap(DegreesFromRotation(rotation)) > maxTheta)
+            {
+                rotation = RotationFromDegrees(maxTheta);
+            }
+            limit.Set(minTheta, maxTheta);
+        }
+
+        definition.mParents.push_back(parent);
+        definition.mChildren.push_back(0);
+        definition.mSiblings.push_back(0);
+        definition.mChildren[parent] = bone;
+        definition.mLengths.push_back(length);
+        definition.mLengthSums.push_back(definition.mLengthSums[parent]+length);
+        definition.mLimits.push_back(limit);
+        definition.mRotations.push_back(rotation);
+        definition.mPreferMin.push_back(limit.PreferMin(rotation));
+
+        FabrikVec2 rotationGlobal = RotateBy(mRotationGlobalCache[parent], rotation);
+        rotationGlobal = rotationGlobal*(1.5f-0.5f*FabrikFloat::LengthSqr(rotationGlobal));
+        mRotationGlobalCache.push_back(rotationGlobal);
+        mJointCache.push_back(start+rotationGlobal*length);
+    }
+
+    mDefinition = built;
+    mOwnsDefinition = true;
+    mRotations = definition.mRotations;
+    mPreferMin = definition.mPreferMin;
+    mTailBone = 0;
+    mStaleBone = 0;
+    MarkDirty(0);
+    mDirtyBone = count;
+    return count-1;
+}
 
-    Vector2 start = GetBoneEnd(last);
-    bone.mLength = Vector2Distance(start, end);
-    bone.mTheta = RAD2DEG*Vector2Angle(Vector2{1, 0}, Vector2Normalize(end-start))-GetThetaGlobal(last);
+uint32_t FabrikPD2D::AddChild(uint32_t parent, FabrikVec2 end)
+{
+    UpdateRotations();
+    UpdateCache();
+
+    Definition& definition = EditDefinition();
+    uint32_t bone = mRotations.size();
+
+    FabrikVec2 start = mJointCache[parent];
+    FabrikVec2 rotation = RotateByInverse(FabrikFloat::Normalize(end-start), mRotationGlobalCache[parent]);
+    FabrikLimit limit;
+    definition.mParents.push_back(parent);
+    definition.mChildren.push_back(0);
+    definition.mSiblings.push_back(0);
+    definition.mLengths.push_back(FabrikFloat::Distance(start, end));
+    definition.mLengthSums.push_back(definition.mLengthSums[parent]+definition.mLengths[bone]);
+    definition.mLimits.push_back(limit);
+    definition.mRotations.push_back(rotation);
+    definition.mPreferMin.push_back(limit.PreferMin(rotation));
+    mRotations.push_back(rotation);
+    mPreferMin.push_back(limit.PreferMin(rotation));
+
+    // LAST IN THE LIST OF CHILDREN
+    if(definition.mChildren[parent] == 0)
+    {
+        definition.mChildren[parent] = bone;
+    }
+    else
+    {
+        uint32_t sibling = definition.mChildren[parent];
+        while(definition.mSiblings[sibling] != 0)
+        {
+            sibling = definition.mSiblings[sibling];
+        }
+        definition.mSiblings[sibling] = bone;
+        definition.mBranched = true;
+    }
 
-    mBones[last].mNext = bone.mID;
-    bone.mPrev = last;
+    mRotationGlobalCache.push_back(FabrikVec2{1, 0});
+    mJointCache.push_back(FabrikVec2{0, 0});
+    MarkDirty(bone);
+    return bone;
+}
 
-    mBones.push_back(bone);
-    return bone.mID;
+uint32_t FabrikPD2D::GetBoneCount()
+{
+    return mRotations.size()-1;
 }
 
 uint32_t FabrikPD2D::GetPrevBone(uint32_t bone)
 {
-    if(bone < 1 || bone >= mBones.size())
+    if(bone < 1 || bone >= mRotations.size())
     {
         return 0;
     }
-    return mBones[bone].mPrev;
+    return mDefinition->mParents[bone];
 }
 uint32_t FabrikPD2D::GetNextBone(uint32_t bone)
 {
-    if(bone < 1 || bone >= mBones.size())
+    if(bone < 1 || bone >= mRotations.size())
     {
         return 0;
     }
-    return mBones[bone].mNext;
+    return mDefinition->mChildren[bone];
 }
-uint32_t FabrikPD2D::GetRoot()
+uint32_t FabrikPD2D::GetSiblingBone(uint32_t bone)
 {
-    if(mBones.size() == 0)
+    if(bone < 1 || bone >= mRotations.size())
     {
         return 0;
     }
-    return 1;
+    return mDefinition->mSiblings[bone];
+}
+uint32_t FabrikPD2D::GetRoot()
+{
+    return mDefinition->mChildren[0];
+}
+bool FabrikPD2D::IsBranched()
+{
+    return mDefinition->mBranched;
 }
 
-Vector2 FabrikPD2D::GetBasePosition()
+FabrikVec2 FabrikPD2D::GetBasePosition()
 {
     return mBasePosition;
 }
-void FabrikPD2D::SetBasePosition(Vector2 position)
+void FabrikPD2D::SetBasePosition(FabrikVec2 position)
 {
+    UpdateRotations();
     mBasePosition = position;
+    MarkDirty(0);
 }
 
 float FabrikPD2D::GetBaseTheta()
@@ -109,116 +423,157 @@ float FabrikPD2D::GetBaseTheta()
 }
 void FabrikPD2D::SetBaseTheta(float theta)
 {
+    UpdateRotations();
     mBaseTheta = theta;
+    mBaseRotation = RotationFromDegrees(theta);
+    MarkDirty(0);
 }
 
 float FabrikPD2D::GetTheta(uint32_t bone)
 {
-    if(bone < 1 || bone >= mBones.size())
+    if(bone < 1 || bone >= mRotations.size())
     {
         return 0;
     }
-    return mBones[bone].mTheta;
+    UpdateRotations(bone);
+    return mDefinition->mLimits[bone].Unwrap(DegreesFromRotation(mRotations[bone]));
 }
 void FabrikPD2D::SetTheta(uint32_t bone, float theta)
 {
-    if(bone < 1 || bone >= mBones.size())
+    if(bone < 1 || bone >= mRotations.size())
     {
         return;
     }
-    if(theta < mBones[bone].mMinTheta)
+    UpdateRotations();
+    if(theta < mDefinition->mLimits[bone].GetMinTheta())
     {
-        theta = mBones[bone].mMinTheta;
+        theta = mDefinition->mLimits[bone].GetMinTheta();
     }
-    if(theta > mBones[bone].mMaxTheta)
+    if(theta > mDefinition->mLimits[bone].GetMaxTheta())
     {
-        theta = mBones[bone].mMaxTheta;
+        theta = mDefinition->mLimits[bone].GetMaxTheta();
     }
-    mBones[bone].mTheta = theta;
+    mRotations[bone] = RotationFromDegrees(theta);
+    mPreferMin[bone] = mDefinition->mLimits[bone].PreferMin(mRotations[bone]);
+    MarkDirty(bone);
 }
 
 float FabrikPD2D::GetLength(uint32_t bone)
 {
-    if(bone < 1 || bone >= mBones.size())
+    if(bone < 1 || bone >= mRotations.size())
     {
         return 0;
     }
-    return mBones[bone].mLength;
+    return mDefinition->mLengths[bone];
 }
 void FabrikPD2D::SetLength(uint32_t bone, float length)
 {
-    if(bone < 1 || bone >= mBones.size())
+    if(bone < 1 || bone >= mRotations.size())
     {
         return;
     }
-    mBones[bone].mLength = length;
+    UpdateRotations();
+    Definition& definition = EditDefinition();
+    definition.mLengths[bone] = length;
+    // PARENTS COME FIRST, SO ONE PASS OVER THE SUFFIX SEES EVERY DESCENDANT
+    for(uint32_t i = bone; i < mRotations.size(); i++)
+    {
+        definition.mLengthSums[i] = definition.mLengthSums[definition.mParents[i]]+definition.mLengths[i];
+    }
+    MarkDirty(bone);
 }
 
-Vector2 FabrikPD2D::GetBoneStart(uint32_t bone)
+FabrikVec2 FabrikPD2D::GetBoneStart(uint32_t bone)
 {
-    if(bone < 1 || bone >= mBones.size())
+    if(bone < 1 || bone >= mRotations.size())
     {
-        return Vector2{0, 0};
+        return FabrikVec2{0, 0};
     }
+    FollowTail(mDefinition->mParents[bone]);
+    UpdateCache();
+    return mJointCache[mDefinition->mParents[bone]];
+}
 
-    Vector2 position = mBasePosition;
-    float thetaGlobal = mBaseTheta;
-    uint32_t curr = 1;
-    while(curr < bone)
+FabrikVec2 FabrikPD2D::GetBoneEnd(uint32_t bone)
+{
+    if(bone < 1 || bone >= mRotations.size())
     {
-        float length = mBones[curr].mLength;
-        float theta = mBones[curr].mTheta;
-        thetaGlobal += theta;
-        position += Vector2Rotate(Vector2{1, 0}, thetaGlobal*DEG2RAD)*length;
-        curr++;
+        return FabrikVec2{0, 0};
     }
-
-    return position;
+    FollowTail(bone);
+    UpdateCache();
+    return mJointCache[bone];
 }
 
-Vector2 FabrikPD2D::GetBoneEnd(uint32_t bone)
+float FabrikPD2D::GetThetaGlobal(uint32_t bone)
 {
-    if(bone < 1 || bone >= mBones.size())
+    if(bone < 1 || bone >= mRotations.size())
     {
-        return Vector2{0, 0};
+        return mBaseTheta;
     }
+    UpdateRotations(bone);
+    UpdateCache();
+    return DegreesFromRotation(mRotationGlobalCache[bone]);
+}
 
-    Vector2 position = mBasePosition;
-    float theta = mBaseTheta;
-    uint32_t curr = 1;
-    while(curr <= bone)
+void FabrikPD2D::MarkDirty(uint32_t bone)
+{
+    ++mRevision;
+    if(bone < mDirtyBone)
     {
-        theta += mBones[curr].mTheta;
-        position += Vector2Rotate(Vector2{1, 0}, theta*DEG2RAD)*mBones[curr].mLength;
-        curr++;
+        mDirtyBone = bone;
     }
-
-    return position;
 }
 
-float FabrikPD2D::GetThetaGlobal(uint32_t bone)
+void FabrikPD2D::UpdateCache()
 {
-    if(bone < 1 || bone >= mBones.size())
+    uint32_t curr = mDirtyBone;
+    if(curr == 0)
     {
-        return mBaseTheta;
+        mRotationGlobalCache[0] = mBaseRotation;
+        mJointCache[0] = mBasePosition;
+        curr = 1;
     }
 
-    float theta = mBaseTheta;
-    uint32_t curr = 1;
-    while(curr <= bone)
+    // ONLY THE DIRTY SUFFIX IS RECOMPUTED, PARENTS BEFORE CHILDREN
+    if(mScan != nullptr && !mDefinition->mBranched)
+    {
+        mScan->Run(mRotations.data(), mDefinition->mLengths.data(), mRotationGlobalCache.data(), mJointCache.data(),
+            curr, mRotations.size());
+        curr = mRotations.size();
+    }
+    while(curr < mRotations.size())
     {
-        theta += mBones[curr].mTheta;
+        uint32_t parent = mDefinition->mParents[curr];
+        FabrikVec2 rotationGlobal = RotateBy(mRotationGlobalCache[parent], mRotations[curr]);
+        // FIRST ORDER RENORMALIZATION KEEPS LONG PRODUCTS ON THE UNIT CIRCLE
+        rotationGlobal = rotationGlobal*(1.5f-0.5f*FabrikFloat::LengthSqr(rotationGlobal));
+        mRotationGlobalCache[curr] = rotationGlobal;
+        mJointCache[curr] = mJointCache[parent]+rotationGlobal*mDefinition->mLengths[curr];
         curr++;
     }
-    return theta;
+
+    mDirtyBone = mRotations.size();
+}
+
+void FabrikPD2D::ResetPose()
+{
+    mRotations = mDefinition->mRotations;
+    mPreferMin = mDefinition->mPreferMin;
+    mRotationGlobalCache.assign(mRotations.size(), FabrikVec2{1, 0});
+    mJointCache.assign(mRotations.size(), FabrikVec2{0, 0});
+    mTailBone = 0;
+    mStaleBone = 0;
+    MarkDirty(0);
 }
 
 void FabrikPD2D::SetMinTheta(uint32_t bone, float theta)
 {
-    if(bone < 1 || bone >= mBones.size())
+    if(bone < 1 || bone >= mRotations.size())
     {
         return;
     }
+    UpdateRotations();
     if(theta < -360)
     {
         theta = -360;
@@ -227,27 +582,38 @@ void FabrikPD2D::SetMinTheta(uint32_t bone, float theta)
     {
         theta = 360;
     }
-    if(mBones[bone].mTheta < theta)
+    Definition& definition = EditDefinition();
+    // THE POSES READ IN THE DEGREES OF THE LIMIT BEING REPLACED
+    const FabrikLimit& limit = definition.mLimits[bone];
+    if(limit.Unwrap(DegreesFromRotation(mRotations[bone])) < theta)
+    {
+        mRotations[bone] = RotationFromDegrees(theta);
+    }
+    if(limit.Unwrap(DegreesFromRotation(definition.mRotations[bone])) < theta)
     {
-        mBones[bone].mTheta = theta;
+        definition.mRotations[bone] = RotationFromDegrees(theta);
     }
-    mBones[bone].mMinTheta = theta;
+    definition.mLimits[bone].Set(theta, definition.mLimits[bone].GetMaxTheta());
+    definition.mPreferMin[bone] = definition.mLimits[bone].PreferMin(definition.mRotations[bone]);
+    mPreferMin[bone] = definition.mLimits[bone].PreferMin(mRotations[bone]);
+    MarkDirty(bone);
 }
 float FabrikPD2D::GetMinTheta(uint32_t bone)
 {
-    if(bone < 1 || bone >= mBones.size())
+    if(bone < 1 || bone >= mRotations.size())
     {
         return 0;
     }
-    return mBones[bone].mMinTheta;
+    return mDefinition->mLimits[bone].GetMinTheta();
 }
 
 void FabrikPD2D::SetMaxTheta(uint32_t bone, float theta)
 {
-    if(bone < 1 || bone >= mBones.size())
+    if(bone < 1 || bone >= mRotations.size())
     {
         return;
     }
+    UpdateRotations();
     if(theta < -360)
     {
         theta = -360;
@@ -256,24 +622,35 @@ void FabrikPD2D::SetMaxTheta(uint32_t bone, float theta)
     {
         theta = 360;
     }
-    if(mBones[bone].mTheta > theta)
+    Definition& definition = EditDefinition();
+    // THE POSES READ IN THE DEGREES OF THE LIMIT BEING REPLACED
+    const FabrikLimit& limit = definition.mLimits[bone];
+    if(limit.Unwrap(DegreesFromRotation(mRotations[bone])) > theta)
     {
-        mBones[bone].mTheta = theta;
+        mRotations[bone] = RotationFromDegrees(theta);
     }
-    mBones[bone].mMaxTheta = theta;
+    if(limit.Unwrap(DegreesFromRotation(definition.mRotations[bone])) > theta)
+    {
+        definition.mRotations[bone] = RotationFromDegrees(theta);
+    }
+    definition.mLimits[bone].Set(definition.mLimits[bone].GetMinTheta(), theta);
+    definition.mPreferMin[bone] = definition.mLimits[bone].PreferMin(definition.mRotations[bone]);
+    mPreferMin[bone] = definition.mLimits[bone].PreferMin(mRotations[bone]);
+    MarkDirty(bone);
 }
 float FabrikPD2D::GetMaxTheta(uint32_t bone)
 {
-    if(bone < 1 || bone >= mBones.size())
+    if(bone < 1 || bone >= mRotations.size())
     {
         return 0;
     }
-    return mBones[bone].mMaxTheta;
+    return mDefinition->mLimits[bone].GetMaxTheta();
 }
 
 void FabrikPD2D::SetIterationLimit(uint32_t limit)
 {
     mIterationLimit = limit;
+    ++mRevision;
 }
 uint32_t FabrikPD2D::GetIterationLimit()
 {
@@ -283,6 +660,7 @@ uint32_t FabrikPD2D::GetIterationLimit()
 void FabrikPD2D::SetIterationThreshold(float threshold)
 {
     mIterationThreshold = threshold;
+    ++mRevision;
 }
 float FabrikPD2D::GetIterationThreshold()
 {
@@ -292,335 +670,854 @@ float FabrikPD2D::GetIterationThreshold()
 void FabrikPD2D::SetThreshold(float threshold)
 {
     mThreshold = threshold;
+    ++mRevision;
 }
 float FabrikPD2D::GetThreshold()
 {
     return mThreshold;
 }
 
-void FabrikPD2D::Solve(std::vector<uint32_t> effectors, std::vector<Vector2> targets, std::vector<bool> fixed)
+void FabrikPD2D::SetTargetEpsilon(float epsilon)
+{
+    mTargetEpsilon = epsilon;
+}
+float FabrikPD2D::GetTargetEpsilon()
 {
-    if(mBones.size() <= 2)
+    return mTargetEpsilon;
+}
+
+void FabrikPD2D::Solve(const std::vector<uint32_t>& effectors, const std::vector<FabrikVec2>& targets, const std::vector<bool>& fixed)
+{
+    // KEEP THE SET (AND ITS FRAME TO FRAME STATE) WHILE THE EFFECTORS STAY THE SAME
+    bool same = mLegacyEffectors.GetCount() == effectors.size();
+    for(uint32_t i = 0; i < effectors.size() && same; i++)
     {
-        return;
+        same = mLegacyEffectors.GetBone(i) == effectors[i] && mLegacyEffectors.GetFixed(i) == fixed[i];
     }
 
-    std::map<uint32_t, Vector2> mpTarget;
-    std::map<uint32_t, bool> mpFixed;
-    for(int i = 0; i < effectors.size(); i++)
+    if(same)
     {
-        mpTarget[effectors[i]] = targets[i];
-        mpFixed[effectors[i]] = fixed[i];
+        // EFFECTOR i WAS ADDED i-TH
+        for(uint32_t i = 0; i < effectors.size(); i++)
+        {
+            mLegacyEffectors.SetTarget(i, targets[i]);
+        }
     }
-
-    uint32_t base = 1;
-    uint32_t curr = 1;
-    while(curr < mBones.size())
+    else
     {
-        if(mpTarget.find(curr) != mpTarget.end())
+        // REPEATED BONES KEEP THEIR LAST TARGET AND FLAG
+        mLegacyEffectors.Clear();
+        for(uint32_t i = 0; i < effectors.size(); i++)
         {
-            SolveSingleEnd(base, curr, mpTarget[curr]);
-            if(mpFixed[curr])
-            {
-                base = curr;
-            }
+            mLegacyEffectors.SetTarget(mLegacyEffectors.Add(effectors[i], fixed[i]), targets[i]);
         }
-        ++curr;
     }
+    SolveEffectors(mLegacyEffectors, nullptr);
 }
 
-void FabrikPD2D::SolveSingleEnd(uint32_t base, uint32_t effector, Vector2 target)
+void FabrikPD2D::Solve(EffectorSet& effectors)
 {
-    uint32_t numberOfNodes = effector-base+1;
-    Vector2 baseStart = GetBoneStart(base);
-    float baseTheta = GetThetaGlobal(base-1);
+    SolveEffectors(effectors, nullptr);
+}
 
-    std::vector<Vector2> positions(numberOfNodes);
-    std::vector<float> lengths(numberOfNodes);
+void FabrikPD2D::Solve(EffectorSet& effectors, const FabrikVec2* targets, uint32_t count)
+{
+    if(count < effectors.GetCount())
     {
-        Vector2 start = baseStart;
-        float thetaGlobal = baseTheta;
-
-        uint32_t curr = base;
-        int i = 0;
-        while(curr <= effector)
-        {
-            positions[i] = start;
-            lengths[i] = mBones[curr].mLength;
+        return;
+    }
+    SolveEffectors(effectors, targets);
+}
 
-            thetaGlobal += mBones[curr].mTheta;
-            start += Vector2Rotate(Vector2{1, 0}, DEG2RAD*thetaGlobal)*mBones[curr].mLength;
-            ++curr;
-            ++i;
-        }
+void FabrikPD2D::SolveEffectors(EffectorSet& effectors, const FabrikVec2* targets)
+{
+    if(!mCollectStats)
+    {
+        SolvePose(effectors, targets);
+        return;
     }
 
-    Vector2 prevEffectorStart = target;
-    uint32_t iterations = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-    while((Vector2Distance(positions[numberOfNodes-1], target) > mThreshold) && (Vector2Distance(positions[numberOfNodes-1], prevEffectorStart) > mIterationThreshold) && (iterations < mIterationLimit))
+    // SolvePose FILLS IN WHAT IT DID FOR EACH EFFECTOR
+    mStats.mEffectors.resize(effectors.mEntries.size());
+    for(const EffectorSet::Entry& entry : effectors.mEntries)
     {
-        prevEffectorStart = positions[numberOfNodes-1];
+        SolveStats::Effector& stats = mStats.mEffectors[entry.mEffector];
+        stats.mBone = entry.mBone;
+        stats.mIterations = 0;
+        stats.mTermination = FabrikReachStats::TERMINATION_NONE;
+    }
+    mStats.mClamps = 0;
 
-        // FORWARD REACHING
-        int i = numberOfNodes-1;
-        uint32_t curr = effector;
-        positions[i] = target;
-        --curr;
-        --i;
-        while(i >= 0 && i+1 < numberOfNodes)
-        {
-            float r = Vector2Distance(positions[i], positions[i+1]);
-            float lambda = lengths[i]/r;
-            positions[i] = positions[i+1]*(1-lambda) + positions[i]*(lambda);
+    SolvePose(effectors, targets);
 
-            if(i < numberOfNodes-2)
-            {
-                Vector2 a = positions[i+1]-positions[i];
-                Vector2 b = positions[i+2]-positions[i+1];
-                float theta = RAD2DEG*Vector2Angle(a, b);
+    for(const EffectorSet::Entry& entry : effectors.mEntries)
+    {
+        mStats.mEffectors[entry.mEffector].mError = entry.mLastError;
+    }
+    mStats.mNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-start).count();
+}
 
-                float minTheta = mBones[curr].mMinTheta;
-                while(minTheta < 0)
-                {
-                    minTheta += 360;
-                }
-                float maxTheta = mBones[curr].mMaxTheta;
-                while(maxTheta <= minTheta)
-                {
-                    maxTheta += 360;
-                }
-                while(theta < minTheta)
-                {
-                    theta += 360;
-                }
+void FabrikPD2D::SolvePose(EffectorSet& effectors, const FabrikVec2* targets)
+{
+    if(mRotations.size() <= 2)
+    {
+        return;
+    }
 
-                if(theta > maxTheta)
+    // THE POSE IS STILL THE ANSWER IF NOTHING CHANGED AND NO TARGET MOVED
+    if(effectors.mSolver == this && effectors.mRevision == mRevision)
+    {
+        bool moved = false;
+        for(const EffectorSet::Entry& entry : effectors.mEntries)
+        {
+            FabrikVec2 target = targets ? targets[entry.mEffector] : entry.mTarget;
+            if(FabrikFloat::DistanceSqr(target, entry.mLastTarget) > mTargetEpsilon*mTargetEpsilon)
+            {
+                moved = true;
+                break;
+            }
+        }
+        if(!moved)
+        {
+            if(mCollectStats)
+            {
+                for(const EffectorSet::Entry& entry : effectors.mEntries)
                 {
-                    float currentTheta = mBones[curr].mTheta;
-                    while(currentTheta < minTheta && currentTheta+360 <= maxTheta)
+                    if(entry.mBone >= 1 && entry.mBone < mRotations.size())
                     {
-                        currentTheta += 360;
-                    }
-                    if(abs(currentTheta-minTheta) < maxTheta-currentTheta)
-                    {
-                        positions[i] = positions[i+1]+Vector2Rotate(Vector2Normalize(Vector2Invert(b)), DEG2RAD*-mBones[curr].mMinTheta)*lengths[i];
-                    }
-                    else
-                    {
-                        positions[i] = positions[i+1]+Vector2Rotate(Vector2Normalize(Vector2Invert(b)), DEG2RAD*-mBones[curr].mMaxTheta)*lengths[i];
+                        mStats.mEffectors[entry.mEffector].mTermination = FabrikReachStats::TERMINATION_SKIPPED;
                     }
                 }
             }
-            --curr;
-            --i;
+            return;
         }
+    }
 
-        // BACKWARD REACHING
-        i = 0;
-        curr = base;
-        positions[i] = baseStart;
-        while(i < numberOfNodes-1)
+    if(mDefinition->mBranched)
+    {
+        SolveMultiEnd(effectors, targets);
+    }
+    else
+    {
+        // EACH EFFECTOR SOLVES THE SEGMENT FROM THE LAST fixed ONE AND ONLY DRAGS
+        // THE BONES UP TO THE NEXT EFFECTOR, THE REST OF THE TAIL FOLLOWS ONCE AFTER
+        // THE LAST.
+        bool changed = effectors.mSolver != this || effectors.mRevision != mRevision;
+        uint32_t base = 1;
+        uint32_t count = effectors.mEntries.size();
+        for(uint32_t k = 0; k < count; k++)
         {
-            float r = Vector2Distance(positions[i], positions[i+1]);
-            float lambda = lengths[i]/r;
-            positions[i+1] = positions[i]*(1-lambda) + positions[i+1]*(lambda);
-
-            Vector2 a;
-            Vector2 b;
-            float theta;
-            if(i == 0)
+            EffectorSet::Entry& entry = effectors.mEntries[k];
+            if(entry.mBone < 1 || entry.mBone >= mRotations.size())
             {
-                a = Vector2Rotate(Vector2{1, 0}, DEG2RAD*GetThetaGlobal(curr-1));
-                b = positions[i+1]-positions[i];
-                theta = RAD2DEG*Vector2Angle(a, b);
+                continue;
             }
-            else if(i > 0)
+            FabrikVec2 target = targets ? targets[entry.mEffector] : entry.mTarget;
+            uint32_t tail = mRotations.size();
+            if(k+1 < count && effectors.mEntries[k+1].mBone < tail)
             {
-                a = positions[i]-positions[i-1];
-                b = positions[i+1]-positions[i];
-                theta = RAD2DEG*Vector2Angle(a, b);
+                tail = effectors.mEntries[k+1].mBone;
             }
 
-            float minTheta = mBones[curr].mMinTheta;
-            while(minTheta < 0)
-            {
-                minTheta += 360;
-            }
-            float maxTheta = mBones[curr].mMaxTheta;
-            while(maxTheta <= minTheta)
+            // A SEGMENT KEEPS ITS POSE ONLY IF THE BONES ARE THE SAME REVISION,
+            // NOTHING BEFORE IT WAS SOLVED AGAIN (SO ITS BASE, THE ROOT OR THE
+            // LAST fixed EFFECTOR, IS PINNED), ITS TARGET DID NOT MOVE, AND NO
+            // LATER SEGMENT SOLVES ITS BONES: IT IS fixed ITSELF OR THE LAST. A
+            // SEGMENT AFTER ONE THAT IS NOT fixed THEREFORE ALWAYS SOLVES.
+            bool shared = !entry.mFixed && tail < mRotations.size();
+            changed = changed || shared || FabrikFloat::DistanceSqr(target, entry.mLastTarget) > mTargetEpsilon*mTargetEpsilon;
+            if(changed)
             {
-                maxTheta += 360;
+                SolveSingleEnd(base, entry.mBone, target, tail);
+                entry.mLastTarget = target;
             }
-            while(theta < minTheta)
+            if(mCollectStats)
             {
-                theta += 360;
-            }
-
-            if(theta > maxTheta)
-            {
-                float currentTheta = mBones[curr].mTheta;
-                while(currentTheta < minTheta && currentTheta+360 <= maxTheta)
-                {
-                    currentTheta += 360;
-                }
-                if(abs(currentTheta-minTheta) < maxTheta-currentTheta)
+                SolveStats::Effector& stats = mStats.mEffectors[entry.mEffector];
+                if(changed)
                 {
-                    positions[i+1] = positions[i]+Vector2Rotate(Vector2Normalize(a), DEG2RAD*mBones[curr].mMinTheta)*lengths[i];
+                    stats.mIterations = mReachStats.mIterations;
+                    stats.mTermination = mReachStats.mTermination;
+                    mStats.mClamps += mReachStats.mClamps;
                 }
                 else
                 {
-                    positions[i+1] = positions[i]+Vector2Rotate(Vector2Normalize(a), DEG2RAD*mBones[curr].mMaxTheta)*lengths[i];
+                    stats.mTermination = FabrikReachStats::TERMINATION_SKIPPED;
                 }
             }
+            if(entry.mFixed)
+            {
+                base = entry.mBone;
+            }
+        }
+    }
 
-            ++i;
-            ++curr;
+    // ERRORS ARE MEASURED ON THE FINAL POSE
+    UpdateCache();
+    for(EffectorSet::Entry& entry : effectors.mEntries)
+    {
+        if(entry.mBone >= 1 && entry.mBone < mRotations.size())
+        {
+            entry.mLastError = FabrikFloat::Distance(mJointCache[mDefinition->mParents[entry.mBone]], entry.mLastTarget);
         }
+    }
+    effectors.mSolver = this;
+    effectors.mRevision = mRevision;
+}
 
-        ++iterations;
+uint32_t FabrikPD2D::GetScratchAllocations()
+{
+    return mScratch.mAllocations;
+}
+
+bool FabrikPD2D::EvaluateTargets(uint32_t effector, const FabrikVec2* candidates, uint32_t count, TargetResult* results, FabrikVec2* poses)
+{
+    float inner;
+    float outer;
+    if(!PrepareQuery(effector, inner, outer))
+    {
+        return false;
+    }
+
+    // ONE SCRATCH FOR ALL THE CANDIDATES, THEIR STATS ARE THROWN AWAY
+    FabrikVec2* positions = mScratch.mPositions.data();
+    for(uint32_t c = 0; c < count; c++)
+    {
+        TargetResult& result = results[c];
+        if(!EvaluateClosedForm(effector, candidates[c], inner, outer, positions, result))
+        {
+            FabrikReachStats stats = FabrikReachStats();
+            FabrikReachView view = GetReachView(1, effector);
+            view.mStats = &stats;
+            FabrikReachIterate<true, 0>(view, candidates[c]);
+
+            result.mError = FabrikFloat::Distance(positions[effector-1], candidates[c]);
+            result.mReachable = result.mError <= mThreshold;
+        }
+        if(poses != nullptr)
+        {
+            std::copy(positions, positions+effector, poses+c*effector);
+        }
+    }
+    return true;
+}
+
+bool FabrikPD2D::PrepareQuery(uint32_t effector, float& inner, float& outer)
+{
+    // THE CASES Solve RUNS AS ONE SINGLE END SOLVE FROM THE BASE
+    if(mDefinition->mBranched || mRotations.size() <= 2 || effector < 1 || effector >= mRotations.size())
+    {
+        return false;
     }
+
+    // THE JOINTS AS GetBoneEnd WOULD SEE THEM
+    FollowTail(effector-1);
+    UpdateCache();
+    mScratch.Reserve(mRotations.size()+1, false);
+    std::copy(mJointCache.begin(), mJointCache.begin()+effector, mScratch.mPositionsRemain.data());
+
+    // THE LONGEST BONE CAN ONLY FOLD BACK AS FAR AS THE OTHERS REACH
+    float longest = 0;
+    for(uint32_t bone = 1; bone < effector; bone++)
+    {
+        longest = std::max(longest, mDefinition->mLengths[bone]);
+    }
+    outer = mDefinition->mLengthSums[effector-1];
+    inner = std::max(0.f, 2*longest-outer);
+    return true;
+}
+
+bool FabrikPD2D::EvaluateClosedForm(uint32_t effector, FabrikVec2 target, float inner, float outer, FabrikVec2* positions, TargetResult& result)
+{
+    const FabrikVec2* current = mScratch.mPositionsRemain.data();
+    result.mRejected = false;
+
+    // THE BASE ITSELF GOES TO THE TARGET
     if(effector == 1)
     {
         positions[0] = target;
+        result.mReachable = true;
+        result.mError = 0;
+        return true;
     }
 
-    // FOR REMAINING NODES AFTER EFFECTOR
-    uint32_t numberOfRemain = mBones.back().mID-effector+1 + 1; // additional joint for end of last node
-    std::vector<Vector2> positionsRemain(numberOfRemain);
-    std::vector<float> lengthsRemain(numberOfRemain);
+    std::copy(current, current+effector, positions);
+
+    // NO POSE PUTS THE EFFECTOR CLOSER THAN THE ANNULUS, LIMITS ONLY SHRINK IT
+    float distance = FabrikFloat::Distance(current[0], target);
+    float outside = distance > outer ? distance-outer : inner-distance;
+    if(outside > mThreshold)
     {
-        Vector2 start = GetBoneStart(effector);
-        float thetaGlobal = GetThetaGlobal(effector-1);
+        result.mReachable = false;
+        result.mRejected = true;
+        result.mError = outside;
+        return true;
+    }
 
-        uint32_t curr = effector;
-        int i = 0;
-        while(curr <= mBones.back().mID)
-        {
-            positionsRemain[i] = start;
-            lengthsRemain[i] = mBones[curr].mLength;
+    FabrikReachStats stats = FabrikReachStats();
+    FabrikReachView view = GetReachView(1, effector);
+    view.mPositions = positions;
+    view.mStats = &stats;
+    if(!FabrikReachStraight<true>(view, target) && !FabrikReachAnalytic<true>(view, target))
+    {
+        return false;
+    }
+    result.mError = FabrikFloat::Distance(positions[effector-1], target);
+    result.mReachable = result.mError <= mThreshold;
+    return true;
+}
 
-            thetaGlobal += mBones[curr].mTheta;
-            start += Vector2Rotate(Vector2{1, 0}, DEG2RAD*thetaGlobal)*mBones[curr].mLength;
-            ++curr;
-            ++i;
+void FabrikPD2D::SetCanonical(Canonical canonical)
+{
+    UpdateRotations();
+    mCanonical = canonical;
+}
+FabrikPD2D::Canonical FabrikPD2D::GetCanonical()
+{
+    return mCanonical;
+}
+
+void FabrikPD2D::SetScan(FabrikScan* scan)
+{
+    mScan = scan;
+}
+FabrikScan* FabrikPD2D::GetScan()
+{
+    return mScan;
+}
+
+void FabrikPD2D::SetCollectStats(bool collect)
+{
+    mCollectStats = collect;
+}
+bool FabrikPD2D::GetCollectStats()
+{
+    return mCollectStats;
+}
+
+const FabrikPD2D::SolveStats& FabrikPD2D::GetLastStats()
+{
+    return mStats;
+}
+
+void FabrikPD2D::SolveSingleEnd(uint32_t base, uint32_t effector, FabrikVec2 target, uint32_t tail)
+{
+    PrepareSingleEnd(base, effector);
+    ReachSingleEnd(base, effector, target);
+    FinishSingleEnd(base, effector, target, tail);
+}
+
+void FabrikPD2D::SolveMultiEnd(EffectorSet& effectors, const FabrikVec2* targets)
+{
+    enum
+    {
+        JOINT_TARGETED = 1,
+        JOINT_ACTIVE = 2 // A TARGET AT OR BELOW IT, MOVED BY THE ITERATIONS
+    };
+
+    FollowTail();
+    UpdateCache();
+    mScratch.Reserve(mRotations.size()+1, true);
+
+    uint32_t joints = mRotations.size();
+    FabrikVec2* positions = mScratch.mPositions.data();
+    FabrikVec2* previous = mScratch.mPositionsRemain.data();
+    FabrikVec2* jointTargets = mScratch.mTargets.data();
+    FabrikVec2* sums = mScratch.mSums.data();
+    uint32_t* counts = mScratch.mCounts.data();
+    uint8_t* flags = mScratch.mFlags.data();
+
+    // JOINTS ARE INDEXED LIKE THE FK CACHE: [0] IS THE BASE, [i] THE END OF BONE i
+    std::copy(mJointCache.begin(), mJointCache.end(), positions);
+    std::fill(flags, flags+joints, 0);
+
+    // AN EFFECTOR TARGETS THE START OF ITS BONE, THE END OF ITS PARENT
+    for(EffectorSet::Entry& entry : effectors.mEntries)
+    {
+        if(entry.mBone < 1 || entry.mBone >= joints)
+        {
+            continue;
         }
-        positionsRemain[i] = start; // end of last node
+        FabrikVec2 target = targets ? targets[entry.mEffector] : entry.mTarget;
+        uint32_t joint = mDefinition->mParents[entry.mBone];
+        jointTargets[joint] = target;
+        previous[joint] = target;
+        flags[joint] |= JOINT_TARGETED;
+        entry.mLastTarget = target;
+    }
 
-        // BACKWARD REACHING ONCE
-        i = 0;
-        curr = effector;
-        positionsRemain[i] = positions.back();
-        while(i < numberOfRemain-1)
+    // A TARGET ON THE BASE MOVES IT, AS IN THE SINGLE END SOLVE
+    if(flags[0] & JOINT_TARGETED)
+    {
+        positions[0] = jointTargets[0];
+    }
+
+    // CHILDREN COME AFTER THEIR PARENTS, SO ONE REVERSE PASS MARKS EVERY PATH TO A TARGET
+    for(uint32_t j = joints-1; j >= 1; j--)
+    {
+        if(flags[j] != 0)
         {
-            float r = Vector2Distance(positionsRemain[i], positionsRemain[i+1]);
-            float lambda = lengthsRemain[i]/r;
-            positionsRemain[i+1] = positionsRemain[i]*(1-lambda) + positionsRemain[i+1]*(lambda);
+            flags[j] |= JOINT_ACTIVE;
+            flags[mDefinition->mParents[j]] |= JOINT_ACTIVE;
+        }
+    }
 
-            Vector2 a;
-            if(curr == 1)
+    uint32_t iterations = 0;
+    uint32_t clamps = 0;
+    bool moved = true;
+    while(iterations < mIterationLimit)
+    {
+        // GOES ON WHILE A TARGET IS MISSED AND SOME EFFECTOR STILL MOVES
+        bool missed = false;
+        moved = false;
+        for(uint32_t j = 1; j < joints; j++)
+        {
+            if(flags[j] & JOINT_TARGETED)
             {
-                a = Vector2Rotate(Vector2{1, 0}, DEG2RAD*GetThetaGlobal(curr-1));
+                missed = missed || FabrikFloat::Distance(positions[j], jointTargets[j]) > mThreshold;
+                moved = moved || FabrikFloat::Distance(positions[j], previous[j]) > mIterationThreshold;
+                previous[j] = positions[j];
             }
-            else if(curr > 1)
+        }
+        if(!missed || !moved)
+        {
+            break;
+        }
+
+        // FORWARD REACHING, CHILDREN FIRST. A SUB-BASE GOES TO THE CENTROID OF
+        // WHERE ITS ACTIVE CHILDREN PULL IT UNLESS IT HAS A TARGET OF ITS OWN.
+        std::fill(sums, sums+joints, FabrikVec2{0, 0});
+        std::fill(counts, counts+joints, 0);
+        for(uint32_t j = joints-1; j >= 1; j--)
+        {
+            if(!(flags[j] & JOINT_ACTIVE))
             {
-                if(i > 0)
-                {
-                    a = positionsRemain[i]-positionsRemain[i-1];
-                }
-                else if(numberOfNodes > 1)
-                {
-                    a = positionsRemain[i]-positions[numberOfNodes-2];
-                }
-                else
-                {
-                    a = positionsRemain[i]-GetBoneStart(curr-1);
-                }
+                continue;
             }
-            Vector2 b = positionsRemain[i+1]-positionsRemain[i];
-            float theta = RAD2DEG*Vector2Angle(a, b);
-
-            float minTheta = mBones[curr].mMinTheta;
-            while(minTheta < 0)
+            if(flags[j] & JOINT_TARGETED)
             {
-                minTheta += 360;
+                positions[j] = jointTargets[j];
             }
-            float maxTheta = mBones[curr].mMaxTheta;
-            while(maxTheta <= minTheta)
+            else
             {
-                maxTheta += 360;
+                positions[j] = sums[j]/(float)counts[j];
             }
-            while(theta < minTheta)
+
+            uint32_t parent = mDefinition->mParents[j];
+            float r = FabrikFloat::Distance(positions[parent], positions[j]);
+            float lambda = mDefinition->mLengths[j]/r;
+            sums[parent] += positions[j]*(1-lambda) + positions[parent]*(lambda);
+            ++counts[parent];
+        }
+
+        // BACKWARD REACHING FROM THE BASE, PARENTS FIRST
+        for(uint32_t j = 1; j < joints; j++)
+        {
+            if((flags[j] & JOINT_ACTIVE) && FollowParent(j, positions))
             {
-                theta += 360;
+                ++clamps;
             }
+        }
 
-            if(theta > maxTheta)
+        ++iterations;
+    }
+
+    // BRANCHES WITHOUT A TARGET FOLLOW ONCE
+    for(uint32_t j = 1; j < joints; j++)
+    {
+        if(!(flags[j] & JOINT_ACTIVE) && FollowParent(j, positions))
+        {
+            ++clamps;
+        }
+    }
+
+    // THE SOLVED JOINTS GO STRAIGHT INTO THE FK CACHE AND SEED THE NEXT SOLVE
+    mBasePosition = positions[0];
+    mJointCache[0] = positions[0];
+    if(mCanonical == CANONICAL_POSITIONS)
+    {
+        // ONLY THE LIMITED BONES WORK OUT THEIR ROTATION, FOR THE SIDE THEY CLAMP TO
+        MarkStale(1, joints);
+        for(uint32_t j = 1; j < joints; j++)
+        {
+            const FabrikLimit& limit = mDefinition->mLimits[j];
+            if(!limit.IsFree())
             {
-                float currentTheta = mBones[curr].mTheta;
-                while(currentTheta < minTheta && currentTheta+360 <= maxTheta)
-                {
-                    currentTheta += 360;
-                }
-                if(abs(currentTheta-minTheta) < maxTheta-currentTheta)
-                {
-                    positionsRemain[i+1] = positionsRemain[i]+Vector2Rotate(Vector2Normalize(a), DEG2RAD*mBones[curr].mMinTheta)*lengthsRemain[i];
-                }
-                else
-                {
-                    positionsRemain[i+1] = positionsRemain[i]+Vector2Rotate(Vector2Normalize(a), DEG2RAD*mBones[curr].mMaxTheta)*lengthsRemain[i];
-                }
+                uint32_t parent = mDefinition->mParents[j];
+                FabrikVec2 direction = FabrikFloat::Normalize(positions[j]-positions[parent]);
+                FabrikVec2 parentDirection = parent == 0 ? mRotationGlobalCache[0]
+                    : FabrikFloat::Normalize(positions[parent]-positions[mDefinition->mParents[parent]]);
+                mPreferMin[j] = limit.PreferMin(RotateByInverse(direction, parentDirection));
             }
+            mJointCache[j] = positions[j];
+        }
+    }
+    else
+    {
+        for(uint32_t j = 1; j < joints; j++)
+        {
+            uint32_t parent = mDefinition->mParents[j];
+            FabrikVec2 direction = FabrikFloat::Normalize(positions[j]-positions[parent]);
+            mRotations[j] = RotateByInverse(direction, mRotationGlobalCache[parent]);
+            mPreferMin[j] = mDefinition->mLimits[j].PreferMin(mRotations[j]);
 
-            ++i;
-            ++curr;
+            mRotationGlobalCache[j] = direction;
+            mJointCache[j] = positions[j];
+        }
+    }
+    ++mRevision;
+
+    if(mCollectStats)
+    {
+        // ONE LOOP FOR ALL, AN EFFECTOR WITHIN THE THRESHOLD CONVERGED WHATEVER STOPPED IT
+        FabrikReachStats::Termination termination = !moved ? FabrikReachStats::TERMINATION_STALLED : FabrikReachStats::TERMINATION_ITERATION_LIMIT;
+        for(const EffectorSet::Entry& entry : effectors.mEntries)
+        {
+            if(entry.mBone < 1 || entry.mBone >= joints)
+            {
+                continue;
+            }
+            SolveStats::Effector& stats = mStats.mEffectors[entry.mEffector];
+            stats.mIterations = iterations;
+            bool converged = FabrikFloat::Distance(positions[mDefinition->mParents[entry.mBone]], entry.mLastTarget) <= mThreshold;
+            stats.mTermination = converged ? FabrikReachStats::TERMINATION_CONVERGED : termination;
         }
+        mStats.mClamps += clamps;
+    }
+}
+
+bool FabrikPD2D::FollowParent(uint32_t bone, FabrikVec2* positions)
+{
+    uint32_t parent = mDefinition->mParents[bone];
+    float r = FabrikFloat::Distance(positions[parent], positions[bone]);
+    float lambda = mDefinition->mLengths[bone]/r;
+    positions[bone] = positions[parent]*(1-lambda) + positions[bone]*(lambda);
+
+    FabrikVec2 a = parent == 0 ? mBaseRotation : positions[parent]-positions[mDefinition->mParents[parent]];
+    FabrikVec2 b = positions[bone]-positions[parent];
+
+    FabrikVec2 limit;
+    if(mDefinition->mLimits[bone].Constrain(LocalDirection(a, b), mPreferMin[bone] != 0, limit))
+    {
+        positions[bone] = positions[parent]+RotateBy(FabrikFloat::Normalize(a), limit)*mDefinition->mLengths[bone];
+        return true;
+    }
+    return false;
+}
+
+void FabrikPD2D::PrepareSingleEnd(uint32_t base, uint32_t effector)
+{
+    // THE SEGMENT STARTS FROM THE JOINTS OF A DEFERRED TAIL IT REACHES INTO
+    if(mTailBone != 0 && effector > mTailBone)
+    {
+        FollowTail();
+    }
+
+    // LENGTHS ARE READ IN PLACE, ONLY THE JOINTS ARE COPIED TO SCRATCH
+    UpdateCache();
+    mScratch.Reserve(mRotations.size()+1, false);
+    // THE REACHING PASSES START ALONG THE BONE BEFORE base
+    mRotationGlobalCache[base-1] = GetDirection(base-1);
+    mReachStats = FabrikReachStats();
+    std::copy(mJointCache.begin()+(base-1), mJointCache.begin()+effector, mScratch.mPositions.data());
+}
+
+FabrikReachView FabrikPD2D::GetReachView(uint32_t base, uint32_t effector)
+{
+    FabrikReachView view;
+    view.mPositions = mScratch.mPositions.data();
+    view.mLengths = mDefinition->mLengths.data()+base;
+    view.mLimits = mDefinition->mLimits.data()+base;
+    view.mPreferMin = mPreferMin.data()+base;
+    view.mNodes = effector-base+1;
+    view.mBaseStart = mJointCache[base-1];
+    view.mBaseDirection = mRotationGlobalCache[base-1];
+    // SUB-CHAIN FROM THE START OF base TO THE START OF effector
+    view.mReach = mDefinition->mLengthSums[effector-1]-mDefinition->mLengthSums[base-1];
+    view.mThreshold = mThreshold;
+    view.mIterationThreshold = mIterationThreshold;
+    view.mIterationLimit = mIterationLimit;
+    view.mStats = &mReachStats;
+    return view;
+}
+
+void FabrikPD2D::ReachSingleEnd(uint32_t base, uint32_t effector, FabrikVec2 target)
+{
+    if(ReachClosedForm(base, effector, target))
+    {
+        return;
+    }
+    FabrikReachIterate<true, 0>(GetReachView(base, effector), target);
+}
+
+bool FabrikPD2D::ReachClosedForm(uint32_t base, uint32_t effector, FabrikVec2 target)
+{
+    FabrikReachView view = GetReachView(base, effector);
+    return FabrikReachStraight<true>(view, target) || FabrikReachAnalytic<true>(view, target);
+}
+
+void FabrikPD2D::FinishSingleEnd(uint32_t base, uint32_t effector, FabrikVec2 target, uint32_t tail)
+{
+    // A DEFERRED TAIL THIS ONE DOES NOT COVER IS FOLLOWED BEFORE ITS ANCHOR
+    // MOVES. ONE IT COVERS IS DROPPED, THE NEW PASS STARTS FROM WHERE THOSE
+    // BONES WERE LAST FOLLOWED.
+    if(mTailBone != 0 && (effector > mTailBone || tail < mTailEnd))
+    {
+        FollowTail();
     }
 
+    uint32_t numberOfNodes = effector-base+1;
+
+    FabrikVec2 baseStart = mJointCache[base-1];
+    FabrikVec2 baseDirection = mRotationGlobalCache[base-1];
+
+    FabrikVec2* positions = mScratch.mPositions.data();
+
+    if(effector == 1)
+    {
+        positions[0] = target;
+    }
+
+    if(mCanonical == CANONICAL_POSITIONS)
+    {
+        StoreJoints(base, baseStart, baseDirection, positions+1, numberOfNodes-1);
+    }
+    else
     {
         // FOR NODES IN ACTION
-        Vector2 start = baseStart;
-        float thetaGlobal = baseTheta;
+        FabrikVec2 start = baseStart;
+        FabrikVec2 rotationGlobal = baseDirection;
 
         uint32_t curr = base;
-        int i = 1;
+        uint32_t i = 1;
         while(i < numberOfNodes)
         {
-            Vector2 end = positions[i];
+            FabrikVec2 end = positions[i];
+
+            FabrikVec2 direction = FabrikFloat::Normalize(end-start);
+            mRotations[curr] = RotateByInverse(direction, rotationGlobal);
+            mPreferMin[curr] = mDefinition->mLimits[curr].PreferMin(mRotations[curr]);
 
-            float theta = RAD2DEG*Vector2Angle(Vector2{1, 0}, Vector2Normalize(end-start))-thetaGlobal;
-            mBones[curr].mTheta = theta;
+            // THE SOLVED JOINTS GO STRAIGHT INTO THE FK CACHE AND SEED THE NEXT SOLVE
+            mRotationGlobalCache[curr] = direction;
+            mJointCache[curr] = end;
 
-            thetaGlobal += theta;
+            rotationGlobal = direction;
             start = end;
             ++curr;
             ++i;
         }
     }
 
+    // THE BONES AFTER THE EFFECTOR FOLLOW ITS NEW START ONLY WHEN SOMEBODY
+    // LOOKS AT THEM, SEE FollowTail
+    if(tail > effector)
+    {
+        mTailBone = effector;
+        mTailEnd = tail;
+    }
+
+    if(effector == 1)
+    {
+        mBasePosition = target;
+        mJointCache[0] = target;
+    }
+    ++mRevision;
+}
+
+void FabrikPD2D::FollowTail()
+{
+    if(mTailBone == 0)
+    {
+        return;
+    }
+    uint32_t effector = mTailBone;
+    uint32_t tail = mTailEnd;
+    mTailBone = 0;
+
+    // THE SOLVED BONES BEFORE effector ARE IN THE FK CACHE, THE TAIL STILL
+    // HOLDS ITS JOINTS FROM BEFORE THAT SOLVE
+    uint32_t numberOfRemain = tail-effector + 1; // additional joint for end of last node
+    FabrikVec2* positionsRemain = mScratch.mPositionsRemain.data();
+    const float* lengthsRemain = mDefinition->mLengths.data()+effector;
+    std::copy(mJointCache.begin()+(effector-1), mJointCache.begin()+tail, positionsRemain);
+
+    {
+        // BACKWARD REACHING ONCE
+        uint32_t i = 0;
+        uint32_t curr = effector;
+        while(i < numberOfRemain-1)
+        {
+            float r = FabrikFloat::Distance(positionsRemain[i], positionsRemain[i+1]);
+            float lambda = lengthsRemain[i]/r;
+            positionsRemain[i+1] = positionsRemain[i]*(1-lambda) + positionsRemain[i+1]*(lambda);
+
+            FabrikVec2 a;
+            if(curr == 1)
+            {
+                a = mBaseRotation;
+            }
+            else if(i > 0)
+            {
+                a = positionsRemain[i]-positionsRemain[i-1];
+            }
+            else
+            {
+                a = positionsRemain[i]-mJointCache[curr-2];
+            }
+            FabrikVec2 b = positionsRemain[i+1]-positionsRemain[i];
+
+            FabrikVec2 limit;
+            if(mDefinition->mLimits[curr].Constrain(LocalDirection(a, b), mPreferMin[curr] != 0, limit))
+            {
+                positionsRemain[i+1] = positionsRemain[i]+RotateBy(FabrikFloat::Normalize(a), limit)*lengthsRemain[i];
+            }
+
+            ++i;
+            ++curr;
+        }
+    }
+
+    if(mCanonical == CANONICAL_POSITIONS)
+    {
+        StoreJoints(effector, positionsRemain[0], GetDirection(effector-1), positionsRemain+1, numberOfRemain-1);
+    }
+    else
     {
         // FOR REMAINING NODES
-        Vector2 start = positionsRemain[0];
-        float thetaGlobal = GetThetaGlobal(effector-1);
+        FabrikVec2 start = positionsRemain[0];
+        FabrikVec2 rotationGlobal = mRotationGlobalCache[effector-1];
 
         uint32_t curr = effector;
-        int i = 1;
+        uint32_t i = 1;
         while(i < numberOfRemain)
         {
-            Vector2 end = positionsRemain[i];
+            FabrikVec2 end = positionsRemain[i];
+
+            FabrikVec2 direction = FabrikFloat::Normalize(end-start);
+            mRotations[curr] = RotateByInverse(direction, rotationGlobal);
+            mPreferMin[curr] = mDefinition->mLimits[curr].PreferMin(mRotations[curr]);
 
-            float theta = RAD2DEG*Vector2Angle(Vector2{1, 0}, Vector2Normalize(end-start))-thetaGlobal;
-            mBones[curr].mTheta = theta;
+            mRotationGlobalCache[curr] = direction;
+            mJointCache[curr] = end;
 
-            thetaGlobal += theta;
+            rotationGlobal = direction;
             start = end;
             ++curr;
             ++i;
         }
     }
+}
 
-    if(effector == 1)
+void FabrikPD2D::FollowTail(uint32_t bone)
+{
+    if(mTailBone != 0 && bone >= mTailBone)
     {
-        mBasePosition = target;
+        FollowTail();
+    }
+}
+
+void FabrikPD2D::UpdateRotations()
+{
+    FollowTail();
+    DeriveRotations();
+}
+
+void FabrikPD2D::UpdateRotations(uint32_t bone)
+{
+    FollowTail(bone);
+    if(mStaleBone != 0 && bone >= mStaleBone && bone < mStaleEnd)
+    {
+        DeriveRotations();
+    }
+}
+
+void FabrikPD2D::DeriveRotations()
+{
+    if(mStaleBone == 0)
+    {
+        return;
+    }
+
+    // THE SAME SWEEP FinishSingleEnd MAKES WITH CANONICAL_ROTATIONS
+    for(uint32_t curr = mStaleBone; curr < mStaleEnd; curr++)
+    {
+        uint32_t parent = mDefinition->mParents[curr];
+        FabrikVec2 direction = FabrikFloat::Normalize(mJointCache[curr]-mJointCache[parent]);
+        mRotations[curr] = RotateByInverse(direction, mRotationGlobalCache[parent]);
+        mPreferMin[curr] = mDefinition->mLimits[curr].PreferMin(mRotations[curr]);
+        mRotationGlobalCache[curr] = direction;
+    }
+    mStaleBone = 0;
+}
+
+void FabrikPD2D::StoreJoints(uint32_t first, FabrikVec2 start, FabrikVec2 direction, const FabrikVec2* ends, uint32_t count)
+{
+    // ONLY A LIMITED BONE WORKS OUT ITS ROTATION, FOR THE SIDE IT CLAMPS TO.
+    // rotationGlobal IS THE DIRECTION OF THE BONE BEFORE WHEN known.
+    MarkStale(first, first+count);
+
+    FabrikVec2 rotationGlobal = direction;
+    FabrikVec2 previousStart = start;
+    bool known = true;
+    for(uint32_t i = 0; i < count; i++)
+    {
+        uint32_t curr = first+i;
+        FabrikVec2 end = ends[i];
+        const FabrikLimit& limit = mDefinition->mLimits[curr];
+        if(limit.IsFree())
+        {
+            known = false;
+        }
+        else
+        {
+            if(!known)
+            {
+                rotationGlobal = FabrikFloat::Normalize(start-previousStart);
+            }
+            FabrikVec2 boneDirection = FabrikFloat::Normalize(end-start);
+            mPreferMin[curr] = limit.PreferMin(RotateByInverse(boneDirection, rotationGlobal));
+            rotationGlobal = boneDirection;
+            known = true;
+        }
+        mJointCache[curr] = end;
+
+        previousStart = start;
+        start = end;
+    }
+}
+
+void FabrikPD2D::MarkStale(uint32_t begin, uint32_t end)
+{
+    if(begin >= end)
+    {
+        return;
+    }
+
+    // CALLED BEFORE THE JOINTS OF [begin, end) ARE WRITTEN. AN OLD STALE BONE
+    // LEFT OUT OF THE NEW RANGE KEEPS THE ROTATION IT HAD AGAINST ITS PARENT
+    // AS IT IS NOW, AS WITH CANONICAL_ROTATIONS, SO IT IS WORKED OUT FIRST.
+    // ONLY A RANGE ENDING AT begin CAN BE JOINED, NONE OF ITS PARENTS MOVE.
+    if(mStaleBone != 0 && mStaleEnd == begin)
+    {
+        mStaleEnd = end;
+        return;
+    }
+    if(mStaleBone != 0 && (mStaleBone < begin || mStaleEnd > end))
+    {
+        DeriveRotations();
+    }
+    mStaleBone = begin;
+    mStaleEnd = end;
+}
+
+FabrikVec2 FabrikPD2D::GetDirection(uint32_t bone)
+{
+    if(mStaleBone != 0 && bone >= mStaleBone && bone < mStaleEnd)
+    {
+        return FabrikFloat::Normalize(mJointCache[bone]-mJointCache[mDefinition->mParents[bone]]);
     }
+    return mRotationGlobalCache[bone];
 }
\ No newline at end of file
@@ -1,51 +1,190 @@
 #ifndef FABRIKPD2D_HPP
 #define FABRIKPD2D_HPP
 
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <vector>
 
-#include <raylib/raylib.h>
-#include <raylib/raymath.h>
+#include "fabrik_limit.hpp"
+#include "fabrik_reach.hpp"
+#include "fabrik_vector.hpp"
+
+class FabrikScan;
 
 class FabrikPD2D
 {
     private:
 
-    class Bone
+    class Scratch
     {
         private:
 
-        Bone();
-        Bone(uint32_t id, float length, float theta, float minTheta, float maxTheta);
-        Bone(uint32_t id, float length, float theta, float minTheta, float maxTheta, uint32_t prev);
+        Scratch();
 
-        uint32_t mID;
+        // SIZED ON THE FIRST SOLVE, THE MULTI-END ARRAYS ONLY FOR A BRANCHED SKELETON
+        void Reserve(uint32_t joints, bool multiEnd);
+        size_t GetMemoryUsage() const;
 
-        float mLength;
-        float mTheta;
+        std::vector<FabrikVec2> mPositions;
+        std::vector<FabrikVec2> mPositionsRemain;
 
-        float mMinTheta;
-        float mMaxTheta;
+        // MULTI-END SOLVE, INDEXED BY JOINT
+        std::vector<FabrikVec2> mTargets;
+        std::vector<FabrikVec2> mSums; // CHILD PROPOSALS FOR A SUB-BASE
+        std::vector<uint32_t> mCounts;
+        std::vector<uint8_t> mFlags;
 
-        uint32_t mPrev;
-        uint32_t mNext;
+        uint32_t mAllocations;
 
         friend class FabrikPD2D;
+        friend class FabrikBatch;
     };
 
     public:
 
+    // PERSISTENT EFFECTORS, REGISTERED ONCE AND KEPT SORTED BY BONE.
+    // EFFECTOR INDICES RETURNED BY Add() FOLLOW REGISTRATION ORDER.
+    class EffectorSet
+    {
+        public:
+
+        EffectorSet();
+
+        uint32_t Add(uint32_t bone, bool fixed);
+        void Clear();
+
+        uint32_t GetCount() const;
+        uint32_t GetBone(uint32_t effector) const;
+        bool GetFixed(uint32_t effector) const;
+
+        void SetTarget(uint32_t effector, FabrikVec2 target);
+        FabrikVec2 GetTarget(uint32_t effector) const;
+
+        // DISTANCE FROM THE EFFECTOR TO ITS TARGET AFTER THE LAST SOLVE
+        float GetError(uint32_t effector) const;
+
+        private:
+
+        class Entry
+        {
+            private:
+
+            uint32_t mBone;
+            uint32_t mEffector;
+            bool mFixed;
+            FabrikVec2 mTarget;
+
+            // FRAME TO FRAME STATE FROM THE LAST SOLVE
+            FabrikVec2 mLastTarget;
+            float mLastError;
+
+            friend class EffectorSet;
+            friend class FabrikPD2D;
+        };
+
+        std::vector<Entry> mEntries; // SORTED BY BONE
+        std::vector<uint32_t> mSorted; // EFFECTOR INDEX -> ENTRY
+
+        // SOLVER AND ITS REVISION RIGHT AFTER THIS SET WAS LAST SOLVED
+        const FabrikPD2D* mSolver;
+        uint32_t mRevision;
+
+        friend class FabrikPD2D;
+    };
+
+    // WHAT THE LAST Solve DID, RECORDED WHILE SetCollectStats(true)
+    class SolveStats
+    {
+        public:
+
+        class Effector
+        {
+            public:
+
+            uint32_t mBone;
+            uint32_t mIterations;
+            float mError; // DISTANCE TO THE TARGET AFTER THE SOLVE
+            FabrikReachStats::Termination mTermination;
+        };
+
+        std::vector<Effector> mEffectors; // INDEXED LIKE THE EffectorSet
+        uint32_t mClamps; // JOINT LIMITS APPLIED BY THE SOLVE, DEFERRED TAILS NOT INCLUDED
+        uint64_t mNanoseconds; // WALL TIME OF THE CALL
+    };
+
+    // THE SHARED, READ ONLY PART OF A RIG: TOPOLOGY, LENGTHS, LIMITS WITH THEIR
+    // DIRECTIONS, AND THE REST POSE INSTANCES START IN. MANY FabrikPD2D CAN
+    // REFERENCE ONE AND ONLY ADD THEIR POSE, BASE AND FK CACHE. EDITING THE
+    // BONES OF AN INSTANCE (AddBone, SetLength, SetMin/MaxTheta, ...) GIVES
+    // IT ITS OWN COPY FIRST, THE OTHER INSTANCES ARE NOT AFFECTED.
+    class Definition
+    {
+        public:
+
+        Definition();
+
+        uint32_t GetBoneCount() const;
+        bool IsBranched() const;
+
+        // BYTES OF BONE DATA, PAID ONCE FOR ALL THE INSTANCES
+        size_t GetMemoryUsage() const;
+
+        private:
+
+        // INDEXED BY BONE LIKE THE INSTANCE, [0] IS THE BASE
+        std::vector<uint32_t> mParents;
+        std::vector<uint32_t> mChildren; // FIRST CHILD
+        std::vector<uint32_t> mSiblings; // NEXT CHILD OF THE SAME PARENT
+        bool mBranched;
+
+        std::vector<float> mLengths;
+        std::vector<float> mLengthSums; // [i] IS THE LENGTH OF THE PATH FROM THE BASE TO THE END OF BONE i
+        std::vector<FabrikLimit> mLimits;
+
+        // REST POSE: LOCAL ROTATIONS AND THE SIDE EACH LIMIT CLAMPS TO THERE
+        std::vector<FabrikVec2> mRotations;
+        std::vector<uint8_t> mPreferMin;
+
+        friend class FabrikPD2D;
+        friend class FabrikBatch;
+        friend class FabrikRigImage;
+        friend class FabrikRigPack;
+        friend class FabrikRigJson;
+    };
+
     FabrikPD2D();
+    // AN INSTANCE OF definition IN ITS REST POSE, NO BONE DATA IS COPIED
+    explicit FabrikPD2D(std::shared_ptr<const Definition> definition);
+
+    // THE DEFINITION THIS RIG READS ITS BONES FROM, TO SHARE WITH NEW INSTANCES
+    std::shared_ptr<const Definition> GetDefinition();
+    // BYTES HELD BY THIS INSTANCE, THE DEFINITION NOT INCLUDED
+    size_t GetMemoryUsage();
 
-    uint32_t AddRoot(Vector2 start, Vector2 end);
-    uint32_t AddBone(Vector2 end);
+    uint32_t AddRoot(FabrikVec2 start, FabrikVec2 end);
+    // APPENDS TO THE LAST BONE
+    uint32_t AddBone(FabrikVec2 end);
+    // ADDS A CHILD TO parent, 0 STARTS ANOTHER ROOT AT THE BASE. A SECOND
+    // CHILD MAKES THE SKELETON BRANCHED, SEE Solve.
+    uint32_t AddBone(uint32_t parent, FabrikVec2 end);
+    // REPLACES THE BONES WITH A CHAIN THROUGH joints[0..count), joints[0] IS
+    // THE BASE. OPTIONAL LIMITS ARE INDEXED BY BONE, [0] UNUSED. THE SAME
+    // BONES AS AddRoot/AddBone WITH SetMinTheta/SetMaxTheta AFTER EACH, IN
+    // ONE PASS. RETURNS THE LAST BONE, 0 FOR FEWER THAN TWO JOINTS.
+    uint32_t BuildChain(const FabrikVec2* joints, uint32_t count, const float* minThetas = nullptr, const float* maxThetas = nullptr);
 
+    uint32_t GetBoneCount();
+
+    // PREV IS THE PARENT, NEXT THE FIRST CHILD, SIBLINGS SHARE A PARENT
     uint32_t GetPrevBone(uint32_t bone);
     uint32_t GetNextBone(uint32_t bone);
+    uint32_t GetSiblingBone(uint32_t bone);
     uint32_t GetRoot();
+    bool IsBranched();
 
-    Vector2 GetBasePosition();
-    void SetBasePosition(Vector2 position);
+    FabrikVec2 GetBasePosition();
+    void SetBasePosition(FabrikVec2 position);
 
     float GetBaseTheta();
     void SetBaseTheta(float theta);
@@ -56,8 +195,8 @@ class FabrikPD2D
     float GetLength(uint32_t bone);
     void SetLength(uint32_t bone, float length);
 
-    Vector2 GetBoneStart(uint32_t bone);
-    Vector2 GetBoneEnd(uint32_t bone);
+    FabrikVec2 GetBoneStart(uint32_t bone);
+    FabrikVec2 GetBoneEnd(uint32_t bone);
 
     float GetThetaGlobal(uint32_t bone);
 
@@ -76,19 +215,175 @@ class FabrikPD2D
     void SetThreshold(float threshold);
     float GetThreshold();
 
-    void Solve(std::vector<uint32_t> effectors, std::vector<Vector2> targets, std::vector<bool> fixed);
+    // Solve(EffectorSet) IS SKIPPED WHEN NO TARGET MOVED MORE THAN THIS AND
+    // NOTHING ELSE CHANGED SINCE THE SET WAS LAST SOLVED
+    void SetTargetEpsilon(float epsilon);
+    float GetTargetEpsilon();
+
+    // A LINEAR CHAIN SOLVES ONE EFFECTOR AFTER THE OTHER, EACH fixed EFFECTOR
+    // BECOMING THE BASE OF THE NEXT ONES. A BRANCHED SKELETON SOLVES ALL ITS
+    // EFFECTORS TOGETHER WITH MULTI-END FABRIK AND IGNORES fixed.
+    void Solve(const std::vector<uint32_t>& effectors, const std::vector<FabrikVec2>& targets, const std::vector<bool>& fixed);
+
+    // SOLVES WITH THE TARGETS STORED IN THE SET
+    void Solve(EffectorSet& effectors);
+    // SOLVES WITH targets[i] FOR EFFECTOR i, READ IN PLACE
+    void Solve(EffectorSet& effectors, const FabrikVec2* targets, uint32_t count);
+
+    // NUMBER OF TIMES THE SOLVE SCRATCH HAD TO GROW, STAYS CONSTANT IN STEADY STATE
+    uint32_t GetScratchAllocations();
+
+    // ONE CANDIDATE OF EvaluateTargets
+    class TargetResult
+    {
+        public:
+
+        bool mReachable; // THE SOLVE ENDS WITHIN THE THRESHOLD OF THE CANDIDATE
+        bool mRejected; // OUTSIDE THE ANNULUS THE EFFECTOR SWEEPS, NOT SOLVED
+        float mError; // FROM THE EFFECTOR AFTER THE SOLVE, FROM THE ANNULUS WHEN REJECTED
+    };
+
+    // WHAT Solve WOULD DO WITH effector ALONE AIMING AT EACH OF candidates,
+    // EVERY ONE FROM THE CURRENT POSE, WHICH IS LEFT AS IT IS, AS ARE THE
+    // SETTINGS AND GetLastStats. poses, WHEN GIVEN, RECEIVES THE effector
+    // JOINTS FROM THE BASE TO THE START OF effector FOR EACH CANDIDATE, THE
+    // CURRENT ONES WHEN REJECTED. false FOR A BRANCHED SKELETON OR AN effector
+    // NOT ON THE CHAIN. FabrikBatch::EvaluateTargets PUTS THE CANDIDATES IN LANES.
+    bool EvaluateTargets(uint32_t effector, const FabrikVec2* candidates, uint32_t count, TargetResult* results, FabrikVec2* poses = nullptr);
+
+    // WHAT A SOLVE KEEPS AS THE POSE. WITH POSITIONS THE SOLVED JOINTS ARE
+    // STORED AS THEY ARE AND THE ROTATIONS ARE ONLY WORKED OUT WHEN GetTheta,
+    // GetThetaGlobal OR AN EDIT NEEDS THEM, FOR CALLERS THAT ONLY READ
+    // GetBoneStart/GetBoneEnd. THE POSES ARE THE SAME EITHER WAY.
+    enum Canonical
+    {
+        CANONICAL_ROTATIONS = 0,
+        CANONICAL_POSITIONS = 1
+    };
+    void SetCanonical(Canonical canonical);
+    Canonical GetCanonical();
+
+    // THE FK OF A LINEAR CHAIN RUNS ON scan, SEE FabrikScan. nullptr, THE
+    // DEFAULT, KEEPS THE SERIAL SWEEP. NOT OWNED, COPIES OF THE RIG SHARE IT
+    // AND TAKE TURNS ON IT WHEN UPDATED FROM DIFFERENT THREADS.
+    void SetScan(FabrikScan* scan);
+    FabrikScan* GetScan();
+
+    // OFF BY DEFAULT, THE TIMER IS NOT FREE ON SHORT CHAINS
+    void SetCollectStats(bool collect);
+    bool GetCollectStats();
+    const SolveStats& GetLastStats();
 
     private:
 
-    void SolveSingleEnd(uint32_t base, uint32_t effector, Vector2 target);
+    // SolvePose WITH THE STATS AROUND IT
+    void SolveEffectors(EffectorSet& effectors, const FabrikVec2* targets);
+    void SolvePose(EffectorSet& effectors, const FabrikVec2* targets);
+    // THE BONES FROM effector UP TO tail FOLLOW THE SOLVED SUB-CHAIN
+    void SolveSingleEnd(uint32_t base, uint32_t effector, FabrikVec2 target, uint32_t tail);
+    void SolveMultiEnd(EffectorSet& effectors, const FabrikVec2* targets);
+    // MOVES THE END OF bone TO ITS LENGTH FROM ITS START, WITHIN ITS LIMIT.
+    // RETURNS true WHEN THE LIMIT CLAMPED IT.
+    bool FollowParent(uint32_t bone, FabrikVec2* positions);
+    // SolveSingleEnd IN PHASES, THE REACHING PASSES CAN BE RUN BY FabrikBatch INSTEAD
+    void PrepareSingleEnd(uint32_t base, uint32_t effector);
+    void ReachSingleEnd(uint32_t base, uint32_t effector, FabrikVec2 target);
+    // UNREACHABLE TARGETS AND ONE OR TWO BONE SUB-CHAINS NEED NO ITERATIONS,
+    // RETURNS false WHEN THE ITERATIVE PASSES ARE NEEDED
+    bool ReachClosedForm(uint32_t base, uint32_t effector, FabrikVec2 target);
+    FabrikReachView GetReachView(uint32_t base, uint32_t effector);
+    void FinishSingleEnd(uint32_t base, uint32_t effector, FabrikVec2 target, uint32_t tail);
+
+    // EvaluateTargets: THE CURRENT JOINTS UP TO effector GO TO
+    // mScratch.mPositionsRemain, inner AND outer BOUND WHERE THE EFFECTOR CAN
+    // BE WITHOUT LIMITS. THEN EVERY CANDIDATE THAT IS REJECTED, TRIVIAL OR
+    // SOLVED IN CLOSED FORM IS DONE BY EvaluateClosedForm, WHICH RETURNS
+    // false WHEN positions HOLDS THE CURRENT JOINTS FOR THE ITERATIONS.
+    bool PrepareQuery(uint32_t effector, float& inner, float& outer);
+    bool EvaluateClosedForm(uint32_t effector, FabrikVec2 target, float inner, float outer, FabrikVec2* positions, TargetResult& result);
+
+    uint32_t AddChild(uint32_t parent, FabrikVec2 end);
+
+    void MarkDirty(uint32_t bone);
+    void UpdateCache();
+    // DRAGS THE DEFERRED TAIL AFTER THE EFFECTOR IT HANGS FROM, WITH THE
+    // BACKWARD PASS FinishSingleEnd USED TO RUN RIGHT AWAY. EVERYTHING THAT
+    // READS OR EDITS THOSE BONES CALLS IT FIRST, THE SECOND FORM ONLY WHEN
+    // bone IS ONE OF THEM.
+    void FollowTail();
+    void FollowTail(uint32_t bone);
+    // CANONICAL_POSITIONS: BRINGS THE ROTATIONS OF THE STALE BONES BACK FROM
+    // THEIR JOINTS, AFTER THE TAIL. THE SECOND FORM ONLY WHEN bone NEEDS IT.
+    void UpdateRotations();
+    void UpdateRotations(uint32_t bone);
+    // THE ROTATIONS OF THE STALE BONES ALONE, THE TAIL AS IT IS
+    void DeriveRotations();
+    // STORES THE ENDS OF count BONES FROM first ON, THE FIRST STARTING AT
+    // start AFTER A BONE ALONG direction, AND MARKS THEM STALE
+    void StoreJoints(uint32_t first, FabrikVec2 start, FabrikVec2 direction, const FabrikVec2* ends, uint32_t count);
+    // BEFORE THE JOINTS OF BONES [begin, end) ARE OVERWRITTEN
+    void MarkStale(uint32_t begin, uint32_t end);
+    // GLOBAL DIRECTION OF bone, FROM ITS JOINTS WHILE IT IS STALE
+    FabrikVec2 GetDirection(uint32_t bone);
+    // AFTER THE DEFINITION WAS REPLACED: TAKES ITS REST POSE, SIZES THE FK
+    // CACHE AND MARKS EVERYTHING DIRTY
+    void ResetPose();
+    // THE DEFINITION, COPIED FIRST UNLESS THIS RIG IS ITS ONLY USER
+    Definition& EditDefinition();
+
+    // BONE DATA AS STRUCTURE OF ARRAYS, INDEXED BY BONE ([0] IS THE BASE).
+    // A PARENT ALWAYS COMES BEFORE ITS CHILDREN. UNLESS IT IS BRANCHED THE
+    // PARENT OF BONE i IS i-1, WHICH THE SINGLE END SOLVE AND FabrikBatch
+    // RELY ON. NEVER nullptr.
+    std::shared_ptr<const Definition> mDefinition;
+    bool mOwnsDefinition; // CREATED BY THIS RIG, SO IT MAY BE EDITED IN PLACE WHILE UNSHARED
 
-    std::vector<Bone> mBones;
-    Vector2 mBasePosition;
+    // THE POSE, ONE ENTRY PER JOINT OF THE DEFINITION
+    std::vector<FabrikVec2> mRotations; // LOCAL ROTATIONS AS UNIT COMPLEX (cos, sin)
+    std::vector<uint8_t> mPreferMin; // SEE FabrikBasicLimit::PreferMin
+
+    FabrikVec2 mBasePosition;
     float mBaseTheta;
+    FabrikVec2 mBaseRotation;
+
+    // FK CACHE, INDEXED BY BONE: [0] IS THE BASE, [i] IS THE END OF BONE i
+    std::vector<FabrikVec2> mRotationGlobalCache;
+    std::vector<FabrikVec2> mJointCache;
+    uint32_t mDirtyBone;
+    FabrikScan* mScan;
+
+    // BONES [mTailBone, mTailEnd) STILL HAVE TO FOLLOW THE LAST SINGLE END
+    // SOLVE, THEIR ROTATIONS AND FK CACHE ARE FROM BEFORE IT. 0 WHEN NONE.
+    uint32_t mTailBone;
+    uint32_t mTailEnd;
+
+    // WITH CANONICAL_POSITIONS mRotations AND mRotationGlobalCache OF BONES
+    // [mStaleBone, mStaleEnd) ARE OLDER THAN THEIR JOINTS, 0 WHEN NONE.
+    // mPreferMin OF A LIMITED BONE IS NEVER STALE.
+    Canonical mCanonical;
+    uint32_t mStaleBone;
+    uint32_t mStaleEnd;
+
+    // BUMPED BY EVERY CHANGE THAT CAN ALTER A SOLVE RESULT
+    uint32_t mRevision;
+
+    Scratch mScratch;
+    EffectorSet mLegacyEffectors;
 
     uint32_t mIterationLimit;
     float mIterationThreshold;
     float mThreshold;
+    float mTargetEpsilon;
+
+    // THE SINGLE END SOLVE IN PROGRESS, AND THE CALL
+    FabrikReachStats mReachStats;
+    SolveStats mStats;
+    bool mCollectStats;
+
+    friend class FabrikBatch;
+    friend class FabrikRigImage;
+    friend class FabrikRigPack;
+    friend class FabrikRigJson;
 };
 
 #endif
\ No newline at end of file
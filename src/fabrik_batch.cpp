@@ -0,0 +1,502 @@
+#include "fabrik_batch.hpp"
+#include "fabrik_batch_kernel.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+FabrikBatch::FabrikBatch()
+    : mChains(), mBoneCount(0), mIsa(GetSupportedIsa()),
+      mPx(), mPy(), mLengths(), mMinX(), mMinY(), mMaxX(), mMaxY(), mNarrow(), mWide(), mPreferMin()
+{
+}
+
+bool FabrikBatch::AddChain(FabrikPD2D* chain)
+{
+    if(chain == nullptr)
+    {
+        return false;
+    }
+
+    // FabrikPD2D::Solve IGNORES CHAINS WITH A SINGLE BONE, AND THE LANES RUN
+    // THE SINGLE END SOLVE OF A LINEAR CHAIN
+    uint32_t bones = chain->mRotations.size()-1;
+    if(bones < 2 || chain->mDefinition->mBranched)
+    {
+        return false;
+    }
+    if(mChains.size() > 0 && bones != mBoneCount)
+    {
+        return false;
+    }
+
+    if(mChains.size() == 0)
+    {
+        mBoneCount = bones;
+        Reserve(bones);
+    }
+    mChains.push_back(chain);
+    return true;
+}
+
+void FabrikBatch::Clear()
+{
+    mChains.clear();
+    mBoneCount = 0;
+}
+
+uint32_t FabrikBatch::GetChainCount()
+{
+    return mChains.size();
+}
+
+uint32_t FabrikBatch::GetBoneCount()
+{
+    return mBoneCount;
+}
+
+FabrikBatch::Isa FabrikBatch::GetSupportedIsa()
+{
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    if(FabrikBatchHasAVX2() && __builtin_cpu_supports("avx2"))
+    {
+        return ISA_AVX2;
+    }
+    if(FabrikBatchHasSSE() && __builtin_cpu_supports("sse2"))
+    {
+        return ISA_SSE;
+    }
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    // AVX2 NEEDS THE CPU BIT AND THE OS SAVING THE YMM REGISTERS
+    int info[4];
+    __cpuid(info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    bool avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+    if(avx)
+    {
+        __cpuidex(info, 7, 0);
+        if(FabrikBatchHasAVX2() && (info[1] & (1 << 5)) != 0)
+        {
+            return ISA_AVX2;
+        }
+    }
+    if(FabrikBatchHasSSE() && sse2)
+    {
+        return ISA_SSE;
+    }
+#endif
+    return ISA_SCALAR;
+}
+
+void FabrikBatch::SetIsa(Isa isa)
+{
+    Isa supported = GetSupportedIsa();
+    if(isa > supported)
+    {
+        isa = supported;
+    }
+    mIsa = isa;
+}
+
+FabrikBatch::Isa FabrikBatch::GetIsa()
+{
+    return mIsa;
+}
+
+void FabrikBatch::Solve(uint32_t effector, const FabrikVec2* targets, uint32_t count)
+{
+    if(count < mChains.size() || effector < 1 || effector > mBoneCount)
+    {
+        return;
+    }
+
+    if(mIsa == ISA_SCALAR)
+    {
+        for(uint32_t c = 0; c < mChains.size(); c++)
+        {
+            FabrikPD2D* chain = mChains[c];
+            if(!chain->mCollectStats)
+            {
+                chain->SolveSingleEnd(1, effector, targets[c], chain->mRotations.size());
+                continue;
+            }
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            chain->PrepareSingleEnd(1, effector);
+            chain->ReachSingleEnd(1, effector, targets[c]);
+            Record(chain, effector, targets[c], std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-start).count());
+            chain->FinishSingleEnd(1, effector, targets[c], chain->mRotations.size());
+        }
+        return;
+    }
+
+    // A CHAIN MAY HAVE BEEN EDITED IN PLACE SINCE THE LAST CALL
+    for(uint32_t lane = 0; lane < LANES; lane++)
+    {
+        mGathered[lane] = nullptr;
+    }
+
+    uint32_t nodes = effector;
+    uint32_t blocks = (mChains.size()+LANES-1)/LANES;
+    for(uint32_t block = 0; block < blocks; block++)
+    {
+        uint32_t first = block*LANES;
+        uint32_t last = first+LANES < mChains.size() ? first+LANES : mChains.size();
+
+        // THE TIMER ONLY RUNS FOR BLOCKS SOMEBODY COLLECTS STATS IN
+        bool collect = false;
+        for(uint32_t c = first; c < last; c++)
+        {
+            collect = collect || mChains[c]->mCollectStats;
+        }
+        std::chrono::steady_clock::time_point start;
+        if(collect)
+        {
+            start = std::chrono::steady_clock::now();
+        }
+
+        for(uint32_t c = first; c < last; c++)
+        {
+            // CLOSED FORM SOLVES RUN HERE, THEIR LANES STAY INACTIVE
+            mChains[c]->PrepareSingleEnd(1, effector);
+            mClosed[c-first] = mChains[c]->ReachClosedForm(1, effector, targets[c]);
+        }
+        Gather(block, nodes, targets);
+        Reach(nodes, last-first);
+        Scatter(block, nodes);
+
+        uint64_t nanoseconds = 0;
+        if(collect)
+        {
+            nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-start).count()/(last-first);
+        }
+        for(uint32_t c = first; c < last; c++)
+        {
+            FabrikPD2D* chain = mChains[c];
+            if(chain->mCollectStats)
+            {
+                // CLOSED FORM REACHES FILLED THEIR OWN
+                uint32_t lane = c-first;
+                if(!mClosed[lane])
+                {
+                    uint32_t k = (nodes-1)*LANES+lane;
+                    FabrikReachStats& stats = chain->mReachStats;
+                    stats.mIterations = (uint32_t)mIterations[lane];
+                    stats.mClamps = (uint32_t)mClamps[lane];
+                    if(FabrikFloat::Distance(FabrikVec2{mPx[k], mPy[k]}, targets[c]) <= chain->mThreshold)
+                    {
+                        stats.mTermination = FabrikReachStats::TERMINATION_CONVERGED;
+                    }
+                    else if(mStalled[lane] > 0.5f)
+                    {
+                        stats.mTermination = FabrikReachStats::TERMINATION_STALLED;
+                    }
+                    else
+                    {
+                        stats.mTermination = FabrikReachStats::TERMINATION_ITERATION_LIMIT;
+                    }
+                }
+                Record(chain, effector, targets[c], nanoseconds);
+            }
+            chain->FinishSingleEnd(1, effector, targets[c], chain->mRotations.size());
+        }
+    }
+}
+
+bool FabrikBatch::EvaluateTargets(FabrikPD2D& chain, uint32_t effector, const FabrikVec2* candidates, uint32_t count,
+    FabrikPD2D::TargetResult* results, FabrikVec2* poses)
+{
+    if(mIsa == ISA_SCALAR)
+    {
+        return chain.EvaluateTargets(effector, candidates, count, results, poses);
+    }
+
+    float inner;
+    float outer;
+    if(!chain.PrepareQuery(effector, inner, outer))
+    {
+        return false;
+    }
+
+    // THE SAME CHAIN IN EVERY LANE, ONLY THE TARGETS DIFFER
+    uint32_t nodes = effector;
+    Reserve(nodes);
+    const FabrikPD2D::Definition* definition = chain.mDefinition.get();
+    for(uint32_t i = 0; i < nodes; i++)
+    {
+        const FabrikLimit& limit = definition->mLimits[1+i];
+        for(uint32_t lane = 0; lane < LANES; lane++)
+        {
+            uint32_t k = i*LANES+lane;
+            mLengths[k] = definition->mLengths[1+i];
+            mMinX[k] = limit.mMinDir.x;
+            mMinY[k] = limit.mMinDir.y;
+            mMaxX[k] = limit.mMaxDir.x;
+            mMaxY[k] = limit.mMaxDir.y;
+            mNarrow[k] = limit.mWidth <= 180 ? 1.f : 0.f;
+            mWide[k] = limit.mWidth > 180 && limit.mWidth < 360 ? 1.f : 0.f;
+            mPreferMin[k] = chain.mPreferMin[1+i] != 0 ? 1.f : 0.f;
+        }
+    }
+    for(uint32_t lane = 0; lane < LANES; lane++)
+    {
+        mBx[lane] = chain.mJointCache[0].x;
+        mBy[lane] = chain.mJointCache[0].y;
+        mDx[lane] = chain.mRotationGlobalCache[0].x;
+        mDy[lane] = chain.mRotationGlobalCache[0].y;
+        mThreshold[lane] = chain.mThreshold;
+        mIterationThreshold[lane] = chain.mIterationThreshold;
+        mIterationLimit[lane] = chain.mIterationLimit;
+        mGathered[lane] = nullptr;
+    }
+
+    FabrikVec2* positions = chain.mScratch.mPositions.data();
+    uint32_t candidate[LANES];
+    uint32_t c = 0;
+    while(c < count)
+    {
+        // ONLY CANDIDATES THAT ITERATE TAKE A LANE, THE REST ARE DONE HERE
+        uint32_t lanes = 0;
+        for(; c < count && lanes < LANES; c++)
+        {
+            if(chain.EvaluateClosedForm(effector, candidates[c], inner, outer, positions, results[c]))
+            {
+                if(poses != nullptr)
+                {
+                    std::copy(positions, positions+nodes, poses+c*nodes);
+                }
+                continue;
+            }
+            for(uint32_t i = 0; i < nodes; i++)
+            {
+                mPx[i*LANES+lanes] = positions[i].x;
+                mPy[i*LANES+lanes] = positions[i].y;
+            }
+            mTx[lanes] = candidates[c].x;
+            mTy[lanes] = candidates[c].y;
+            mValid[lanes] = 1;
+            candidate[lanes] = c;
+            ++lanes;
+        }
+        if(lanes == 0)
+        {
+            break;
+        }
+
+        // PADDING LANES REPEAT THE FIRST AND STAY INACTIVE
+        for(uint32_t lane = lanes; lane < LANES; lane++)
+        {
+            for(uint32_t i = 0; i < nodes; i++)
+            {
+                mPx[i*LANES+lane] = mPx[i*LANES];
+                mPy[i*LANES+lane] = mPy[i*LANES];
+            }
+            mTx[lane] = mTx[0];
+            mTy[lane] = mTy[0];
+            mValid[lane] = 0;
+        }
+        Reach(nodes, lanes);
+
+        for(uint32_t lane = 0; lane < lanes; lane++)
+        {
+            uint32_t k = (nodes-1)*LANES+lane;
+            FabrikPD2D::TargetResult& result = results[candidate[lane]];
+            result.mError = FabrikFloat::Distance(FabrikVec2{mPx[k], mPy[k]}, candidates[candidate[lane]]);
+            result.mReachable = result.mError <= chain.mThreshold;
+            if(poses != nullptr)
+            {
+                FabrikVec2* pose = poses+candidate[lane]*nodes;
+                for(uint32_t i = 0; i < nodes; i++)
+                {
+                    pose[i] = FabrikVec2{mPx[i*LANES+lane], mPy[i*LANES+lane]};
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void FabrikBatch::Reserve(uint32_t nodes)
+{
+    uint32_t size = nodes*LANES;
+    if(mPx.size() >= size)
+    {
+        return;
+    }
+    mPx.resize(size);
+    mPy.resize(size);
+    mLengths.resize(size);
+    mMinX.resize(size);
+    mMinY.resize(size);
+    mMaxX.resize(size);
+    mMaxY.resize(size);
+    mNarrow.resize(size);
+    mWide.resize(size);
+    mPreferMin.resize(size);
+}
+
+void FabrikBatch::Reach(uint32_t nodes, uint32_t lanes)
+{
+    FabrikBatchView view;
+    view.mPx = mPx.data();
+    view.mPy = mPy.data();
+    view.mLengths = mLengths.data();
+    view.mMinX = mMinX.data();
+    view.mMinY = mMinY.data();
+    view.mMaxX = mMaxX.data();
+    view.mMaxY = mMaxY.data();
+    view.mNarrow = mNarrow.data();
+    view.mWide = mWide.data();
+    view.mPreferMin = mPreferMin.data();
+    view.mTx = mTx;
+    view.mTy = mTy;
+    view.mBx = mBx;
+    view.mBy = mBy;
+    view.mDx = mDx;
+    view.mDy = mDy;
+    view.mThreshold = mThreshold;
+    view.mIterationThreshold = mIterationThreshold;
+    view.mIterationLimit = mIterationLimit;
+    view.mValid = mValid;
+    view.mIterations = mIterations;
+    view.mClamps = mClamps;
+    view.mStalled = mStalled;
+    view.mStride = LANES;
+    view.mNodes = nodes;
+
+    // ONLY PAY FOR THE LIMIT KERNEL WHEN A BONE IN THE BLOCK IS LIMITED
+    view.mConstrained = false;
+    for(uint32_t i = 0; i < nodes*LANES && !view.mConstrained; i++)
+    {
+        view.mConstrained = mNarrow[i] > 0.5f || mWide[i] > 0.5f;
+    }
+
+    if(mIsa == ISA_AVX2)
+    {
+        FabrikBatchReachAVX2(view);
+    }
+    else
+    {
+        // TWO 4-LANE HALVES OF THE BLOCK
+        FabrikBatchReachSSE(view);
+        FabrikBatchView upper = view;
+        upper.mPx += 4;
+        upper.mPy += 4;
+        upper.mLengths += 4;
+        upper.mMinX += 4;
+        upper.mMinY += 4;
+        upper.mMaxX += 4;
+        upper.mMaxY += 4;
+        upper.mNarrow += 4;
+        upper.mWide += 4;
+        upper.mPreferMin += 4;
+        upper.mTx += 4;
+        upper.mTy += 4;
+        upper.mBx += 4;
+        upper.mBy += 4;
+        upper.mDx += 4;
+        upper.mDy += 4;
+        upper.mThreshold += 4;
+        upper.mIterationThreshold += 4;
+        upper.mIterationLimit += 4;
+        upper.mValid += 4;
+        upper.mIterations += 4;
+        upper.mClamps += 4;
+        upper.mStalled += 4;
+        if(lanes > 4)
+        {
+            FabrikBatchReachSSE(upper);
+        }
+    }
+}
+
+void FabrikBatch::Record(FabrikPD2D* chain, uint32_t effector, FabrikVec2 target, uint64_t nanoseconds)
+{
+    // THE REACHED JOINTS ARE STILL IN SCRATCH
+    FabrikPD2D::SolveStats& stats = chain->mStats;
+    stats.mEffectors.resize(1);
+    stats.mEffectors[0].mBone = effector;
+    stats.mEffectors[0].mIterations = chain->mReachStats.mIterations;
+    stats.mEffectors[0].mTermination = chain->mReachStats.mTermination;
+    stats.mEffectors[0].mError = FabrikFloat::Distance(chain->mScratch.mPositions[effector-1], target);
+    stats.mClamps = chain->mReachStats.mClamps;
+    stats.mNanoseconds = nanoseconds;
+}
+
+void FabrikBatch::Gather(uint32_t block, uint32_t nodes, const FabrikVec2* targets)
+{
+    for(uint32_t lane = 0; lane < LANES; lane++)
+    {
+        // PADDING LANES REPEAT THE FIRST CHAIN OF THE BLOCK AND STAY INACTIVE
+        uint32_t c = block*LANES+lane;
+        bool valid = c < mChains.size();
+        if(!valid)
+        {
+            c = block*LANES;
+        }
+        FabrikPD2D* chain = mChains[c];
+
+        const FabrikVec2* positions = chain->mScratch.mPositions.data();
+        for(uint32_t i = 0; i < nodes; i++)
+        {
+            uint32_t k = i*LANES+lane;
+            mPx[k] = positions[i].x;
+            mPy[k] = positions[i].y;
+            mPreferMin[k] = chain->mPreferMin[1+i] != 0 ? 1.f : 0.f;
+        }
+
+        // INSTANCES OF ONE DEFINITION SHARE THEIR LENGTH AND LIMIT COLUMNS,
+        // WHAT THE LANE HOLDS FROM THE LAST BLOCK IS STILL RIGHT
+        const FabrikPD2D::Definition* definition = chain->mDefinition.get();
+        if(definition != mGathered[lane])
+        {
+            for(uint32_t i = 0; i < nodes; i++)
+            {
+                uint32_t k = i*LANES+lane;
+                const FabrikLimit& limit = definition->mLimits[1+i];
+
+                mLengths[k] = definition->mLengths[1+i];
+                mMinX[k] = limit.mMinDir.x;
+                mMinY[k] = limit.mMinDir.y;
+                mMaxX[k] = limit.mMaxDir.x;
+                mMaxY[k] = limit.mMaxDir.y;
+                mNarrow[k] = limit.mWidth <= 180 ? 1.f : 0.f;
+                mWide[k] = limit.mWidth > 180 && limit.mWidth < 360 ? 1.f : 0.f;
+            }
+            mGathered[lane] = definition;
+        }
+
+        mTx[lane] = targets[c].x;
+        mTy[lane] = targets[c].y;
+        mBx[lane] = chain->mJointCache[0].x;
+        mBy[lane] = chain->mJointCache[0].y;
+        mDx[lane] = chain->mRotationGlobalCache[0].x;
+        mDy[lane] = chain->mRotationGlobalCache[0].y;
+        mThreshold[lane] = chain->mThreshold;
+        mIterationThreshold[lane] = chain->mIterationThreshold;
+        mIterationLimit[lane] = chain->mIterationLimit;
+        mValid[lane] = valid && !mClosed[lane] ? 1.f : 0.f;
+    }
+}
+
+void FabrikBatch::Scatter(uint32_t block, uint32_t nodes)
+{
+    for(uint32_t lane = 0; lane < LANES; lane++)
+    {
+        uint32_t c = block*LANES+lane;
+        if(c >= mChains.size())
+        {
+            break;
+        }
+
+        FabrikVec2* positions = mChains[c]->mScratch.mPositions.data();
+        for(uint32_t i = 0; i < nodes; i++)
+        {
+            positions[i] = FabrikVec2{mPx[i*LANES+lane], mPy[i*LANES+lane]};
+        }
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef FABRIKPD2D_BATCH_HPP
+#define FABRIKPD2D_BATCH_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "fabrik.hpp"
+
+// SOLVES MANY FabrikPD2D CHAINS WITH THE SAME BONE COUNT IN LOCKSTEP.
+// CHAIN DATA IS INTERLEAVED BY LANE AND THE REACHING PASSES RUN ON 4 (SSE)
+// OR 8 (AVX2) CHAINS AT ONCE, PICKED AT RUNTIME. RESULTS ARE WRITTEN BACK
+// INTO THE CHAINS, THE SAME AS CALLING Solve ON EACH OF THEM.
+class FabrikBatch
+{
+    public:
+
+    enum Isa
+    {
+        ISA_SCALAR = 0,
+        ISA_SSE = 1,
+        ISA_AVX2 = 2
+    };
+
+    // CHAINS PER BLOCK, WIDE ENOUGH FOR THE WIDEST KERNEL
+    static const uint32_t LANES = 8;
+
+    FabrikBatch();
+
+    // ALL CHAINS MUST HAVE THE BONE COUNT OF THE FIRST ONE ADDED
+    bool AddChain(FabrikPD2D* chain);
+    void Clear();
+
+    uint32_t GetChainCount();
+    uint32_t GetBoneCount();
+
+    // FASTEST INSTRUCTION SET THE CPU AND THE BUILD SUPPORT
+    static Isa GetSupportedIsa();
+
+    // REQUESTS ABOVE THE SUPPORTED SET FALL BACK TO IT
+    void SetIsa(Isa isa);
+    Isa GetIsa();
+
+    // SOLVES effector OF EVERY CHAIN TOWARD targets[chain]. CHAINS THAT COLLECT
+    // STATS GET THOSE OF A ONE EFFECTOR Solve, THE WALL TIME BEING THEIR SHARE
+    // OF THEIR BLOCK.
+    void Solve(uint32_t effector, const FabrikVec2* targets, uint32_t count);
+
+    // FabrikPD2D::EvaluateTargets WITH THE CANDIDATES IN THE LANES, SAME
+    // RESULTS. chain NEED NOT BE IN THE BATCH NOR HAVE ITS BONE COUNT.
+    bool EvaluateTargets(FabrikPD2D& chain, uint32_t effector, const FabrikVec2* candidates, uint32_t count,
+        FabrikPD2D::TargetResult* results, FabrikVec2* poses = nullptr);
+
+    private:
+
+    // GROWS THE LANE DATA TO nodes ROWS
+    void Reserve(uint32_t nodes);
+    // RUNS THE KERNEL ON THE BLOCK, lanes OF WHICH HOLD CHAINS
+    void Reach(uint32_t nodes, uint32_t lanes);
+    void Gather(uint32_t block, uint32_t nodes, const FabrikVec2* targets);
+    void Scatter(uint32_t block, uint32_t nodes);
+    // FILLS GetLastStats OF chain AFTER ITS REACH, BEFORE FinishSingleEnd
+    void Record(FabrikPD2D* chain, uint32_t effector, FabrikVec2 target, uint64_t nanoseconds);
+
+    std::vector<FabrikPD2D*> mChains;
+    uint32_t mBoneCount;
+    Isa mIsa;
+
+    // LANE DATA FOR ONE BLOCK, [node*LANES+lane] OR [lane], REUSED PER BLOCK
+    std::vector<float> mPx;
+    std::vector<float> mPy;
+    std::vector<float> mLengths;
+    std::vector<float> mMinX;
+    std::vector<float> mMinY;
+    std::vector<float> mMaxX;
+    std::vector<float> mMaxY;
+    std::vector<float> mNarrow;
+    std::vector<float> mWide;
+    std::vector<float> mPreferMin;
+    float mTx[LANES];
+    float mTy[LANES];
+    float mBx[LANES];
+    float mBy[LANES];
+    float mDx[LANES];
+    float mDy[LANES];
+    float mThreshold[LANES];
+    float mIterationThreshold[LANES];
+    float mIterationLimit[LANES];
+    float mValid[LANES];
+    float mIterations[LANES];
+    float mClamps[LANES];
+    float mStalled[LANES];
+    bool mClosed[LANES];
+    // WHOSE LENGTHS AND LIMITS EACH LANE HOLDS, RESET BY EVERY Solve
+    const FabrikPD2D::Definition* mGathered[LANES];
+};
+
+#endif
@@ -0,0 +1,57 @@
+#include "fabrik_batch_kernel.hpp"
+
+// BUILT WITH AVX2 ENABLED FOR THIS FILE ONLY, SEE CMakeLists.txt.
+// ONLY CALLED AFTER THE RUNTIME CHECK IN FabrikBatch::GetSupportedIsa().
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+namespace
+{
+    class PackAVX2
+    {
+        public:
+
+        typedef __m256 Type;
+
+        static Type Load(const float* p) { return _mm256_loadu_ps(p); }
+        static void Store(float* p, Type a) { _mm256_storeu_ps(p, a); }
+        static Type Set(float a) { return _mm256_set1_ps(a); }
+
+        static Type Add(Type a, Type b) { return _mm256_add_ps(a, b); }
+        static Type Sub(Type a, Type b) { return _mm256_sub_ps(a, b); }
+        static Type Mul(Type a, Type b) { return _mm256_mul_ps(a, b); }
+        static Type Div(Type a, Type b) { return _mm256_div_ps(a, b); }
+        static Type Sqrt(Type a) { return _mm256_sqrt_ps(a); }
+
+        static Type Lt(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+        static Type Gt(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+        static Type And(Type a, Type b) { return _mm256_and_ps(a, b); }
+        static Type Or(Type a, Type b) { return _mm256_or_ps(a, b); }
+        static Type Blend(Type mask, Type a, Type b) { return _mm256_blendv_ps(b, a, mask); }
+        static bool Any(Type mask) { return _mm256_movemask_ps(mask) != 0; }
+    };
+}
+
+bool FabrikBatchHasAVX2()
+{
+    return true;
+}
+
+void FabrikBatchReachAVX2(const FabrikBatchView& view)
+{
+    FabrikBatchReach<PackAVX2>(view);
+}
+
+#else
+
+bool FabrikBatchHasAVX2()
+{
+    return false;
+}
+
+void FabrikBatchReachAVX2(const FabrikBatchView& view)
+{
+}
+
+#endif
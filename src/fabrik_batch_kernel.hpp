@@ -0,0 +1,249 @@
+#ifndef FABRIKPD2D_BATCH_KERNEL_HPP
+#define FABRIKPD2D_BATCH_KERNEL_HPP
+
+// INTERNAL TO FabrikBatch. THIS HEADER IS INCLUDED BY TRANSLATION UNITS BUILT
+// WITH WIDER INSTRUCTION SETS, SO IT MUST NOT PULL IN HEADERS WITH INLINE
+// FUNCTIONS SHARED WITH THE REST OF THE PROGRAM (fabrik_vector.hpp, std::vector, ...):
+// THE LINKER COULD KEEP THE AVX2 COPY FOR EVERYONE.
+
+#include <cstdint>
+
+// POINTERS INTO ONE BLOCK OF FabrikBatch LANE DATA, OFFSET TO THE FIRST LANE
+// THE KERNEL PROCESSES. PER NODE ARRAYS HAVE A ROW STRIDE OF mStride FLOATS.
+class FabrikBatchView
+{
+    public:
+
+    float* mPx;
+    float* mPy;
+    const float* mLengths;
+    const float* mMinX;
+    const float* mMinY;
+    const float* mMaxX;
+    const float* mMaxY;
+    const float* mNarrow;
+    const float* mWide;
+    const float* mPreferMin;
+    const float* mTx;
+    const float* mTy;
+    const float* mBx;
+    const float* mBy;
+    const float* mDx;
+    const float* mDy;
+    const float* mThreshold;
+    const float* mIterationThreshold;
+    const float* mIterationLimit;
+    const float* mValid;
+
+    // PER LANE, WRITTEN ON RETURN: WHAT FabrikReachStats COUNTS, AND 1 WHERE
+    // THE EFFECTOR STOPPED MOVING
+    float* mIterations;
+    float* mClamps;
+    float* mStalled;
+
+    uint32_t mStride;
+    uint32_t mNodes;
+    bool mConstrained;
+};
+
+bool FabrikBatchHasSSE();
+bool FabrikBatchHasAVX2();
+
+void FabrikBatchReachSSE(const FabrikBatchView& view);
+void FabrikBatchReachAVX2(const FabrikBatchView& view);
+
+// 1/|v|, OR 0 FOR A ZERO VECTOR LIKE Vector2Normalize
+template<class P>
+typename P::Type FabrikBatchInverseLength(typename P::Type x, typename P::Type y)
+{
+    typedef typename P::Type T;
+    T lengthSqr = P::Add(P::Mul(x, x), P::Mul(y, y));
+    return P::Blend(P::Gt(lengthSqr, P::Set(0)), P::Div(P::Set(1), P::Sqrt(lengthSqr)), P::Set(0));
+}
+
+// FabrikPD2D::Limit::Constrain ON A PACK: MASK OF LANES WHOSE CHILD DIRECTION b
+// LEAVES THE LIMIT ARC RELATIVE TO a, AND THE LIMIT DIRECTION TO CLAMP TO.
+template<class P>
+typename P::Type FabrikBatchViolation(const FabrikBatchView& v, uint32_t row,
+    typename P::Type ax, typename P::Type ay, typename P::Type bx, typename P::Type by,
+    typename P::Type& limitX, typename P::Type& limitY)
+{
+    typedef typename P::Type T;
+
+    const T zero = P::Set(0);
+    const T half = P::Set(0.5f);
+
+    T lx = P::Add(P::Mul(ax, bx), P::Mul(ay, by));
+    T ly = P::Sub(P::Mul(ax, by), P::Mul(ay, bx));
+
+    T minX = P::Load(v.mMinX+row);
+    T minY = P::Load(v.mMinY+row);
+    T maxX = P::Load(v.mMaxX+row);
+    T maxY = P::Load(v.mMaxY+row);
+
+    T c1 = P::Lt(P::Sub(P::Mul(minX, ly), P::Mul(minY, lx)), zero);
+    T c2 = P::Lt(P::Sub(P::Mul(lx, maxY), P::Mul(ly, maxX)), zero);
+    T narrow = P::Gt(P::Load(v.mNarrow+row), half);
+    T wide = P::Gt(P::Load(v.mWide+row), half);
+
+    T preferMin = P::Gt(P::Load(v.mPreferMin+row), half);
+    limitX = P::Blend(preferMin, minX, maxX);
+    limitY = P::Blend(preferMin, minY, maxY);
+
+    return P::Or(P::And(narrow, P::Or(c1, c2)), P::And(wide, P::And(c1, c2)));
+}
+
+// FabrikPD2D::ReachSingleEnd FOR base == 1, ON P::WIDTH CHAINS AT ONCE.
+// LANES STOP UPDATING ONCE THEIR OWN LOOP CONDITION FAILS.
+template<class P>
+void FabrikBatchReach(const FabrikBatchView& v)
+{
+    typedef typename P::Type T;
+
+    const uint32_t s = v.mStride;
+    const uint32_t n = v.mNodes;
+    float* px = v.mPx;
+    float* py = v.mPy;
+
+    const T zero = P::Set(0);
+    const T one = P::Set(1);
+    const T half = P::Set(0.5f);
+
+    T tx = P::Load(v.mTx);
+    T ty = P::Load(v.mTy);
+    T bx = P::Load(v.mBx);
+    T by = P::Load(v.mBy);
+    T dx = P::Load(v.mDx);
+    T dy = P::Load(v.mDy);
+    T threshold = P::Load(v.mThreshold);
+    T iterationThreshold = P::Load(v.mIterationThreshold);
+    T iterationLimit = P::Load(v.mIterationLimit);
+
+    T active = P::Gt(P::Load(v.mValid), half);
+    T prevX = tx;
+    T prevY = ty;
+    T iterations = zero;
+    T clamps = zero;
+    T moving;
+
+    while(true)
+    {
+        T ex = P::Load(px+(n-1)*s);
+        T ey = P::Load(py+(n-1)*s);
+
+        T rx = P::Sub(ex, tx);
+        T ry = P::Sub(ey, ty);
+        T qx = P::Sub(ex, prevX);
+        T qy = P::Sub(ey, prevY);
+        T far = P::Gt(P::Sqrt(P::Add(P::Mul(rx, rx), P::Mul(ry, ry))), threshold);
+        moving = P::Gt(P::Sqrt(P::Add(P::Mul(qx, qx), P::Mul(qy, qy))), iterationThreshold);
+        active = P::And(active, P::And(P::And(far, moving), P::Lt(iterations, iterationLimit)));
+        if(!P::Any(active))
+        {
+            break;
+        }
+
+        prevX = P::Blend(active, ex, prevX);
+        prevY = P::Blend(active, ey, prevY);
+
+        // FORWARD REACHING
+        P::Store(px+(n-1)*s, P::Blend(active, tx, ex));
+        P::Store(py+(n-1)*s, P::Blend(active, ty, ey));
+        for(int i = (int)n-2; i >= 0; i--)
+        {
+            T x0 = P::Load(px+i*s);
+            T y0 = P::Load(py+i*s);
+            T x1 = P::Load(px+(i+1)*s);
+            T y1 = P::Load(py+(i+1)*s);
+            T length = P::Load(v.mLengths+i*s);
+
+            T ux = P::Sub(x0, x1);
+            T uy = P::Sub(y0, y1);
+            T lambda = P::Div(length, P::Sqrt(P::Add(P::Mul(ux, ux), P::Mul(uy, uy))));
+            T nx = P::Add(P::Mul(x1, P::Sub(one, lambda)), P::Mul(x0, lambda));
+            T ny = P::Add(P::Mul(y1, P::Sub(one, lambda)), P::Mul(y0, lambda));
+
+            if(v.mConstrained && i < (int)n-2)
+            {
+                T ax = P::Sub(x1, nx);
+                T ay = P::Sub(y1, ny);
+                T bxv = P::Sub(P::Load(px+(i+2)*s), x1);
+                T byv = P::Sub(P::Load(py+(i+2)*s), y1);
+
+                T limitX;
+                T limitY;
+                T outside = FabrikBatchViolation<P>(v, i*s, ax, ay, bxv, byv, limitX, limitY);
+
+                // positions[i] = positions[i+1]-RotateByInverse(Normalize(b), limit)*length
+                T inv = FabrikBatchInverseLength<P>(bxv, byv);
+                T nbx = P::Mul(bxv, inv);
+                T nby = P::Mul(byv, inv);
+                T rx2 = P::Add(P::Mul(nbx, limitX), P::Mul(nby, limitY));
+                T ry2 = P::Sub(P::Mul(nby, limitX), P::Mul(nbx, limitY));
+                nx = P::Blend(outside, P::Sub(x1, P::Mul(rx2, length)), nx);
+                ny = P::Blend(outside, P::Sub(y1, P::Mul(ry2, length)), ny);
+                clamps = P::Add(clamps, P::And(P::And(outside, active), one));
+            }
+
+            P::Store(px+i*s, P::Blend(active, nx, x0));
+            P::Store(py+i*s, P::Blend(active, ny, y0));
+        }
+
+        // BACKWARD REACHING
+        P::Store(px, P::Blend(active, bx, P::Load(px)));
+        P::Store(py, P::Blend(active, by, P::Load(py)));
+        for(uint32_t i = 0; i+1 < n; i++)
+        {
+            T x0 = P::Load(px+i*s);
+            T y0 = P::Load(py+i*s);
+            T x1 = P::Load(px+(i+1)*s);
+            T y1 = P::Load(py+(i+1)*s);
+            T length = P::Load(v.mLengths+i*s);
+
+            T ux = P::Sub(x0, x1);
+            T uy = P::Sub(y0, y1);
+            T lambda = P::Div(length, P::Sqrt(P::Add(P::Mul(ux, ux), P::Mul(uy, uy))));
+            T nx = P::Add(P::Mul(x0, P::Sub(one, lambda)), P::Mul(x1, lambda));
+            T ny = P::Add(P::Mul(y0, P::Sub(one, lambda)), P::Mul(y1, lambda));
+
+            if(v.mConstrained)
+            {
+                T ax = dx;
+                T ay = dy;
+                if(i > 0)
+                {
+                    ax = P::Sub(x0, P::Load(px+(i-1)*s));
+                    ay = P::Sub(y0, P::Load(py+(i-1)*s));
+                }
+                T bxv = P::Sub(nx, x0);
+                T byv = P::Sub(ny, y0);
+
+                T limitX;
+                T limitY;
+                T outside = FabrikBatchViolation<P>(v, i*s, ax, ay, bxv, byv, limitX, limitY);
+
+                // positions[i+1] = positions[i]+RotateBy(Normalize(a), limit)*length
+                T inv = FabrikBatchInverseLength<P>(ax, ay);
+                T nax = P::Mul(ax, inv);
+                T nay = P::Mul(ay, inv);
+                T rx2 = P::Sub(P::Mul(nax, limitX), P::Mul(nay, limitY));
+                T ry2 = P::Add(P::Mul(nax, limitY), P::Mul(nay, limitX));
+                nx = P::Blend(outside, P::Add(x0, P::Mul(rx2, length)), nx);
+                ny = P::Blend(outside, P::Add(y0, P::Mul(ry2, length)), ny);
+                clamps = P::Add(clamps, P::And(P::And(outside, active), one));
+            }
+
+            P::Store(px+(i+1)*s, P::Blend(active, nx, x1));
+            P::Store(py+(i+1)*s, P::Blend(active, ny, y1));
+        }
+
+        iterations = P::Add(iterations, P::And(active, one));
+    }
+
+    // A STOPPED LANE IS FROZEN, THE LAST TEST IS THE ONE THAT STOPPED IT
+    P::Store(v.mIterations, iterations);
+    P::Store(v.mClamps, clamps);
+    P::Store(v.mStalled, P::Blend(moving, zero, one));
+}
+
+#endif
@@ -0,0 +1,55 @@
+#include "fabrik_batch_kernel.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+
+#include <emmintrin.h>
+
+namespace
+{
+    class PackSSE
+    {
+        public:
+
+        typedef __m128 Type;
+
+        static Type Load(const float* p) { return _mm_loadu_ps(p); }
+        static void Store(float* p, Type a) { _mm_storeu_ps(p, a); }
+        static Type Set(float a) { return _mm_set1_ps(a); }
+
+        static Type Add(Type a, Type b) { return _mm_add_ps(a, b); }
+        static Type Sub(Type a, Type b) { return _mm_sub_ps(a, b); }
+        static Type Mul(Type a, Type b) { return _mm_mul_ps(a, b); }
+        static Type Div(Type a, Type b) { return _mm_div_ps(a, b); }
+        static Type Sqrt(Type a) { return _mm_sqrt_ps(a); }
+
+        static Type Lt(Type a, Type b) { return _mm_cmplt_ps(a, b); }
+        static Type Gt(Type a, Type b) { return _mm_cmpgt_ps(a, b); }
+        static Type And(Type a, Type b) { return _mm_and_ps(a, b); }
+        static Type Or(Type a, Type b) { return _mm_or_ps(a, b); }
+        static Type Blend(Type mask, Type a, Type b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+        static bool Any(Type mask) { return _mm_movemask_ps(mask) != 0; }
+    };
+}
+
+bool FabrikBatchHasSSE()
+{
+    return true;
+}
+
+void FabrikBatchReachSSE(const FabrikBatchView& view)
+{
+    FabrikBatchReach<PackSSE>(view);
+}
+
+#else
+
+bool FabrikBatchHasSSE()
+{
+    return false;
+}
+
+void FabrikBatchReachSSE(const FabrikBatchView& view)
+{
+}
+
+#endif
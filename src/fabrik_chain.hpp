@@ -0,0 +1,568 @@
+#ifndef FABRIKPD2D_CHAIN_HPP
+#define FABRIKPD2D_CHAIN_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "fabrik_limit.hpp"
+#include "fabrik_precision.hpp"
+#include "fabrik_reach.hpp"
+
+// CONSTRAINT POLICIES FOR FabrikChain
+class FabrikLimited
+{
+    public:
+
+    static constexpr bool LIMITS = true;
+};
+
+// NO JOINT LIMITS: THE CONSTRAINT CHECKS ARE COMPILED OUT AND SetMin/MaxTheta DO NOT COMPILE
+class FabrikUnlimited
+{
+    public:
+
+    static constexpr bool LIMITS = false;
+};
+
+// STORAGE OF A FabrikChain, ONE ENTRY PER BONE PLUS [0]
+template<uint32_t N, class T>
+class FabrikChainArray
+{
+    public:
+
+    typedef std::array<T, N+1> Type;
+
+    static void Resize(Type&, uint32_t) {}
+};
+
+template<class T>
+class FabrikChainArray<0, T>
+{
+    public:
+
+    typedef std::vector<T> Type;
+
+    static void Resize(Type& array, uint32_t bones) { array.resize(bones+1); }
+};
+
+// A FabrikPD2D WITH N BONES FIXED AT COMPILE TIME. EVERYTHING LIVES IN
+// std::array, NOTHING IS ALLOCATED, AND Solve(effector, target) GIVES THE SAME
+// RESULT AS FabrikPD2D::Solve WITH THE SAME SINGLE NON FIXED EFFECTOR.
+// BONES ARE INDEXED 1..N LIKE IN FabrikPD2D. Precision PICKS THE SCALAR AND
+// VECTOR TYPES OF THE WHOLE CHAIN, API INCLUDED (fabrik_precision.hpp).
+//
+// N == 0 SIZES THE CHAIN AT RUNTIME INSTEAD, LIKE NODES == 0 IN THE REACH
+// KERNELS: FabrikChain<0, FabrikLimited, FabrikDouble> chain(bones) IS A
+// LINEAR CHAIN OF ANY LENGTH IN double. ITS ARRAYS ARE std::vector, ALLOCATED
+// ONCE BY THE CONSTRUCTOR, Solve STILL ALLOCATES NOTHING.
+template<uint32_t N, class Policy = FabrikLimited, class Precision = FabrikFloat>
+class FabrikChain
+{
+    public:
+
+    typedef typename Precision::Scalar S;
+    typedef typename Precision::Vector V;
+
+    // bones ONLY SIZES A RUNTIME CHAIN, A FIXED ONE ALWAYS HAS N
+    explicit FabrikChain(uint32_t bones = N);
+
+    // joints[0] IS THE BASE, joints[i] THE END OF BONE i, GetBoneCount()+1 OF THEM
+    void SetJoints(const V* joints);
+    void SetJoints(const std::array<V, N+1>& joints);
+
+    uint32_t GetBoneCount() const { return mBoneCount; }
+
+    V GetBasePosition();
+    void SetBasePosition(V position);
+
+    S GetBaseTheta();
+    void SetBaseTheta(S theta);
+
+    S GetTheta(uint32_t bone);
+    void SetTheta(uint32_t bone, S theta);
+
+    S GetLength(uint32_t bone);
+    void SetLength(uint32_t bone, S length);
+
+    V GetBoneStart(uint32_t bone);
+    V GetBoneEnd(uint32_t bone);
+
+    S GetThetaGlobal(uint32_t bone);
+
+    void SetMinTheta(uint32_t bone, S theta);
+    S GetMinTheta(uint32_t bone);
+
+    void SetMaxTheta(uint32_t bone, S theta);
+    S GetMaxTheta(uint32_t bone);
+
+    void SetIterationLimit(uint32_t limit);
+    uint32_t GetIterationLimit();
+
+    void SetIterationThreshold(S threshold);
+    S GetIterationThreshold();
+
+    void SetThreshold(S threshold);
+    S GetThreshold();
+
+    // MOVES THE START OF effector TOWARD target, THE BONES AFTER IT FOLLOW
+    void Solve(uint32_t effector, V target);
+
+    // ITERATIONS, CLAMPS AND TERMINATION OF THE LAST Solve
+    const FabrikReachStats& GetLastStats() const;
+
+    private:
+
+    void Finish(uint32_t effector, V target);
+    void UpdateCache();
+
+    template<class T>
+    using Array = typename FabrikChainArray<N, T>::Type;
+
+    uint32_t mBoneCount;
+
+    // SAME LAYOUT AS FabrikPD2D, [0] IS UNUSED
+    Array<S> mLengths;
+    Array<V> mRotations;
+    Array<FabrikBasicLimit<Precision>> mLimits;
+    Array<uint8_t> mPreferMin;
+
+    V mBasePosition;
+    S mBaseTheta;
+    V mBaseRotation;
+
+    // FK CACHE, [0] IS THE BASE, [i] IS THE END OF BONE i
+    Array<V> mRotationGlobalCache;
+    Array<V> mJointCache;
+    bool mDirty;
+
+    Array<V> mPositions;
+    Array<V> mPositionsRemain;
+
+    uint32_t mIterationLimit;
+    S mIterationThreshold;
+    S mThreshold;
+
+    FabrikReachStats mStats;
+};
+
+template<uint32_t N, class Policy, class Precision>
+FabrikChain<N, Policy, Precision>::FabrikChain(uint32_t bones)
+    : mBoneCount(N != 0 ? N : bones), mLengths(), mRotations(), mLimits(), mPreferMin(),
+      mBasePosition{S(0), S(0)}, mBaseTheta(0), mBaseRotation{S(1), S(0)},
+      mRotationGlobalCache(), mJointCache(), mDirty(true), mPositions(), mPositionsRemain(),
+      mIterationLimit(20), mIterationThreshold(Precision::FromFloat(0.1f)), mThreshold(1), mStats()
+{
+    FabrikChainArray<N, S>::Resize(mLengths, mBoneCount);
+    FabrikChainArray<N, V>::Resize(mRotations, mBoneCount);
+    FabrikChainArray<N, FabrikBasicLimit<Precision>>::Resize(mLimits, mBoneCount);
+    FabrikChainArray<N, uint8_t>::Resize(mPreferMin, mBoneCount);
+    FabrikChainArray<N, V>::Resize(mRotationGlobalCache, mBoneCount);
+    FabrikChainArray<N, V>::Resize(mJointCache, mBoneCount);
+    FabrikChainArray<N, V>::Resize(mPositions, mBoneCount);
+    FabrikChainArray<N, V>::Resize(mPositionsRemain, mBoneCount);
+
+    std::fill(mLengths.begin(), mLengths.end(), S(0));
+    std::fill(mRotations.begin(), mRotations.end(), V{S(1), S(0)});
+    std::fill(mPreferMin.begin(), mPreferMin.end(), 1);
+}
+
+template<uint32_t N, class Policy, class Precision>
+void FabrikChain<N, Policy, Precision>::SetJoints(const std::array<V, N+1>& joints)
+{
+    SetJoints(joints.data());
+}
+
+template<uint32_t N, class Policy, class Precision>
+void FabrikChain<N, Policy, Precision>::SetJoints(const V* joints)
+{
+    mBasePosition = joints[0];
+    V rotationGlobal = mBaseRotation;
+    for(uint32_t bone = 1; bone <= mBoneCount; bone++)
+    {
+        V direction = Precision::Normalize(joints[bone]-joints[bone-1]);
+        mLengths[bone] = Precision::Distance(joints[bone-1], joints[bone]);
+        mRotations[bone] = RotateByInverse(direction, rotationGlobal);
+        mPreferMin[bone] = mLimits[bone].PreferMin(mRotations[bone]);
+        rotationGlobal = direction;
+    }
+    mDirty = true;
+}
+
+template<uint32_t N, class Policy, class Precision>
+typename Precision::Vector FabrikChain<N, Policy, Precision>::GetBasePosition()
+{
+    return mBasePosition;
+}
+template<uint32_t N, class Policy, class Precision>
+void FabrikChain<N, Policy, Precision>::SetBasePosition(V position)
+{
+    mBasePosition = position;
+    mDirty = true;
+}
+
+template<uint32_t N, class Policy, class Precision>
+typename Precision::Scalar FabrikChain<N, Policy, Precision>::GetBaseTheta()
+{
+    return mBaseTheta;
+}
+template<uint32_t N, class Policy, class Precision>
+void FabrikChain<N, Policy, Precision>::SetBaseTheta(S theta)
+{
+    mBaseTheta = theta;
+    mBaseRotation = Precision::RotationFromDegrees(theta);
+    mDirty = true;
+}
+
+template<uint32_t N, class Policy, class Precision>
+typename Precision::Scalar FabrikChain<N, Policy, Precision>::GetTheta(uint32_t bone)
+{
+    if(bone < 1 || bone > mBoneCount)
+    {
+        return S(0);
+    }
+    return mLimits[bone].Unwrap(Precision::DegreesFromRotation(mRotations[bone]));
+}
+template<uint32_t N, class Policy, class Precision>
+void FabrikChain<N, Policy, Precision>::SetTheta(uint32_t bone, S theta)
+{
+    if(bone < 1 || bone > mBoneCount)
+    {
+        return;
+    }
+    if(theta < mLimits[bone].GetMinTheta())
+    {
+        theta = mLimits[bone].GetMinTheta();
+    }
+    if(theta > mLimits[bone].GetMaxTheta())
+    {
+        theta = mLimits[bone].GetMaxTheta();
+    }
+    mRotations[bone] = Precision::RotationFromDegrees(theta);
+    mPreferMin[bone] = mLimits[bone].PreferMin(mRotations[bone]);
+    mDirty = true;
+}
+
+template<uint32_t N, class Policy, class Precision>
+typename Precision::Scalar FabrikChain<N, Policy, Precision>::GetLength(uint32_t bone)
+{
+    if(bone < 1 || bone > mBoneCount)
+    {
+        return S(0);
+    }
+    return mLengths[bone];
+}
+template<uint32_t N, class Policy, class Precision>
+void FabrikChain<N, Policy, Precision>::SetLength(uint32_t bone, S length)
+{
+    if(bone < 1 || bone > mBoneCount)
+    {
+        return;
+    }
+    mLengths[bone] = length;
+    mDirty = true;
+}
+
+template<uint32_t N, class Policy, class Precision>
+typename Precision::Vector FabrikChain<N, Policy, Precision>::GetBoneStart(uint32_t bone)
+{
+    if(bone < 1 || bone > mBoneCount)
+    {
+        return V{S(0), S(0)};
+    }
+    UpdateCache();
+    return mJointCache[bone-1];
+}
+
+template<uint32_t N, class Policy, class Precision>
+typename Precision::Vector FabrikChain<N, Policy, Precision>::GetBoneEnd(uint32_t bone)
+{
+    if(bone < 1 || bone > mBoneCount)
+    {
+        return V{S(0), S(0)};
+    }
+    UpdateCache();
+    return mJointCache[bone];
+}
+
+template<uint32_t N, class Policy, class Precision>
+typename Precision::Scalar FabrikChain<N, Policy, Precision>::GetThetaGlobal(uint32_t bone)
+{
+    if(bone < 1 || bone > mBoneCount)
+    {
+        return mBaseTheta;
+    }
+    UpdateCache();
+    return Precision::DegreesFromRotation(mRotationGlobalCache[bone]);
+}
+
+template<uint32_t N, class Policy, class Precision>
+void FabrikChain<N, Policy, Precision>::SetMinTheta(uint32_t bone, S theta)
+{
+    static_assert(Policy::LIMITS, "FabrikChain policy has no joint limits");
+    if(bone < 1 || bone > mBoneCount)
+    {
+        return;
+    }
+    theta = theta < S(-360) ? S(-360) : (theta > S(360) ? S(360) : theta);
+    if(mLimits[bone].Unwrap(Precision::DegreesFromRotation(mRotations[bone])) < theta)
+    {
+        mRotations[bone] = Precision::RotationFromDegrees(theta);
+    }
+    mLimits[bone].Set(theta, mLimits[bone].GetMaxTheta());
+    mPreferMin[bone] = mLimits[bone].PreferMin(mRotations[bone]);
+    mDirty = true;
+}
+template<uint32_t N, class Policy, class Precision>
+typename Precision::Scalar FabrikChain<N, Policy, Precision>::GetMinTheta(uint32_t bone)
+{
+    if(bone < 1 || bone > mBoneCount)
+    {
+        return S(0);
+    }
+    return mLimits[bone].GetMinTheta();
+}
+
+template<uint32_t N, class Policy, class Precision>
+void FabrikChain<N, Policy, Precision>::SetMaxTheta(uint32_t bone, S theta)
+{
+    static_assert(Policy::LIMITS, "FabrikChain policy has no joint limits");
+    if(bone < 1 || bone > mBoneCount)
+    {
+        return;
+    }
+    theta = theta < S(-360) ? S(-360) : (theta > S(360) ? S(360) : theta);
+    if(mLimits[bone].Unwrap(Precision::DegreesFromRotation(mRotations[bone])) > theta)
+    {
+        mRotations[bone] = Precision::RotationFromDegrees(theta);
+    }
+    mLimits[bone].Set(mLimits[bone].GetMinTheta(), theta);
+    mPreferMin[bone] = mLimits[bone].PreferMin(mRotations[bone]);
+    mDirty = true;
+}
+template<uint32_t N, class Policy, class Precision>
+typename Precision::Scalar FabrikChain<N, Policy, Precision>::GetMaxTheta(uint32_t bone)
+{
+    if(bone < 1 || bone > mBoneCount)
+    {
+        return S(0);
+    }
+    return mLimits[bone].GetMaxTheta();
+}
+
+template<uint32_t N, class Policy, class Precision>
+void FabrikChain<N, Policy, Precision>::SetIterationLimit(uint32_t limit)
+{
+    mIterationLimit = limit;
+}
+template<uint32_t N, class Policy, class Precision>
+uint32_t FabrikChain<N, Policy, Precision>::GetIterationLimit()
+{
+    return mIterationLimit;
+}
+
+template<uint32_t N, class Policy, class Precision>
+void FabrikChain<N, Policy, Precision>::SetIterationThreshold(S threshold)
+{
+    mIterationThreshold = threshold;
+}
+template<uint32_t N, class Policy, class Precision>
+typename Precision::Scalar FabrikChain<N, Policy, Precision>::GetIterationThreshold()
+{
+    return mIterationThreshold;
+}
+
+template<uint32_t N, class Policy, class Precision>
+void FabrikChain<N, Policy, Precision>::SetThreshold(S threshold)
+{
+    mThreshold = threshold;
+}
+template<uint32_t N, class Policy, class Precision>
+typename Precision::Scalar FabrikChain<N, Policy, Precision>::GetThreshold()
+{
+    return mThreshold;
+}
+
+template<uint32_t N, class Policy, class Precision>
+void FabrikChain<N, Policy, Precision>::UpdateCache()
+{
+    if(!mDirty)
+    {
+        return;
+    }
+
+    V rotationGlobal = mBaseRotation;
+    V position = mBasePosition;
+    mRotationGlobalCache[0] = rotationGlobal;
+    mJointCache[0] = position;
+    for(uint32_t bone = 1; bone <= mBoneCount; bone++)
+    {
+        rotationGlobal = RotateBy(rotationGlobal, mRotations[bone]);
+        // FIRST ORDER RENORMALIZATION KEEPS LONG PRODUCTS ON THE UNIT CIRCLE
+        rotationGlobal = rotationGlobal*(S(3)/S(2)-Precision::LengthSqr(rotationGlobal)/S(2));
+        position += rotationGlobal*mLengths[bone];
+        mRotationGlobalCache[bone] = rotationGlobal;
+        mJointCache[bone] = position;
+    }
+    mDirty = false;
+}
+
+template<uint32_t N, class Policy, class Precision>
+void FabrikChain<N, Policy, Precision>::Solve(uint32_t effector, V target)
+{
+    mStats = FabrikReachStats();
+
+    // FabrikPD2D IGNORES CHAINS WITH A SINGLE BONE
+    if(mBoneCount < 2 || effector < 1 || effector > mBoneCount)
+    {
+        return;
+    }
+
+    UpdateCache();
+
+    FabrikBasicReachView<Precision> view;
+    view.mPositions = mPositions.data();
+    view.mLengths = mLengths.data()+1;
+    view.mLimits = mLimits.data()+1;
+    view.mPreferMin = mPreferMin.data()+1;
+    view.mNodes = effector;
+    view.mBaseStart = mJointCache[0];
+    view.mBaseDirection = mRotationGlobalCache[0];
+    view.mReach = S(0);
+    view.mThreshold = mThreshold;
+    view.mIterationThreshold = mIterationThreshold;
+    view.mIterationLimit = mIterationLimit;
+    view.mStats = &mStats;
+
+    for(uint32_t i = 0; i < effector; i++)
+    {
+        mPositions[i] = mJointCache[i];
+        if(i > 0)
+        {
+            view.mReach += mLengths[i];
+        }
+    }
+
+    if(!FabrikReachStraight<Policy::LIMITS>(view, target) && !FabrikReachAnalytic<Policy::LIMITS>(view, target))
+    {
+        // THE WHOLE CHAIN IS THE COMMON CASE, LET IT UNROLL. NEVER TRUE AT
+        // RUNTIME SIZE, effector IS AT LEAST 1.
+        if(effector == N)
+        {
+            FabrikReachIterate<Policy::LIMITS, N>(view, target);
+        }
+        else
+        {
+            FabrikReachIterate<Policy::LIMITS, 0>(view, target);
+        }
+    }
+
+    Finish(effector, target);
+}
+
+template<uint32_t N, class Policy, class Precision>
+const FabrikReachStats& FabrikChain<N, Policy, Precision>::GetLastStats() const
+{
+    return mStats;
+}
+
+template<uint32_t N, class Policy, class Precision>
+void FabrikChain<N, Policy, Precision>::Finish(uint32_t effector, V target)
+{
+    // FabrikPD2D::FinishSingleEnd WITH base == 1
+    uint32_t numberOfNodes = effector;
+    V* positions = mPositions.data();
+
+    if(effector == 1)
+    {
+        positions[0] = target;
+    }
+
+    // FOR REMAINING NODES AFTER EFFECTOR, BACKWARD REACHING ONCE
+    uint32_t numberOfRemain = mBoneCount-effector+2;
+    V* positionsRemain = mPositionsRemain.data();
+    const S* lengthsRemain = mLengths.data()+effector;
+    for(uint32_t i = 0; i < numberOfRemain; i++)
+    {
+        positionsRemain[i] = mJointCache[effector-1+i];
+    }
+    positionsRemain[0] = positions[numberOfNodes-1];
+    for(uint32_t i = 0; i+1 < numberOfRemain; i++)
+    {
+        S r = Precision::Distance(positionsRemain[i], positionsRemain[i+1]);
+        S lambda = lengthsRemain[i]/r;
+        positionsRemain[i+1] = positionsRemain[i]*(S(1)-lambda) + positionsRemain[i+1]*(lambda);
+
+        if(Policy::LIMITS)
+        {
+            uint32_t curr = effector+i;
+            V a;
+            if(curr == 1)
+            {
+                a = mBaseRotation;
+            }
+            else if(i > 0)
+            {
+                a = positionsRemain[i]-positionsRemain[i-1];
+            }
+            else
+            {
+                a = positionsRemain[i]-positions[numberOfNodes-2];
+            }
+            V b = positionsRemain[i+1]-positionsRemain[i];
+
+            V limit;
+            if(mLimits[curr].Constrain(LocalDirection(a, b), mPreferMin[curr] != 0, limit))
+            {
+                positionsRemain[i+1] = positionsRemain[i]+RotateBy(Precision::Normalize(a), limit)*lengthsRemain[i];
+                ++mStats.mClamps;
+            }
+        }
+    }
+
+    // FOR NODES IN ACTION, STRAIGHT INTO THE FK CACHE
+    V start = mJointCache[0];
+    V rotationGlobal = mRotationGlobalCache[0];
+    for(uint32_t i = 1; i < numberOfNodes; i++)
+    {
+        V direction = Precision::Normalize(positions[i]-start);
+        mRotations[i] = RotateByInverse(direction, rotationGlobal);
+        if(Policy::LIMITS)
+        {
+            mPreferMin[i] = mLimits[i].PreferMin(mRotations[i]);
+        }
+        mRotationGlobalCache[i] = direction;
+        mJointCache[i] = positions[i];
+
+        rotationGlobal = direction;
+        start = positions[i];
+    }
+
+    // FOR REMAINING NODES
+    start = positionsRemain[0];
+    rotationGlobal = mRotationGlobalCache[effector-1];
+    for(uint32_t i = 1; i < numberOfRemain; i++)
+    {
+        uint32_t curr = effector-1+i;
+        V direction = Precision::Normalize(positionsRemain[i]-start);
+        mRotations[curr] = RotateByInverse(direction, rotationGlobal);
+        if(Policy::LIMITS)
+        {
+            mPreferMin[curr] = mLimits[curr].PreferMin(mRotations[curr]);
+        }
+        mRotationGlobalCache[curr] = direction;
+        mJointCache[curr] = positionsRemain[i];
+
+        rotationGlobal = direction;
+        start = positionsRemain[i];
+    }
+
+    if(effector == 1)
+    {
+        mBasePosition = target;
+        mJointCache[0] = target;
+    }
+}
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef FABRIKPD2D_GLM_HPP
+#define FABRIKPD2D_GLM_HPP
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_aligned.hpp>
+
+#include "fabrik_vector.hpp"
+
+// glm ADAPTER. DEFINE GLM_FORCE_INTRINSICS BEFORE THE FIRST glm INCLUDE FOR
+// THE SSE BACKEND.
+
+inline glm::vec2 FabrikToGlm(FabrikVec2 v)
+{
+    return glm::vec2(v.x, v.y);
+}
+
+inline FabrikVec2 FabrikFromGlm(glm::vec2 v)
+{
+    return FabrikVec2{v.x, v.y};
+}
+
+// MATH BACKEND ON glm::vec2, SCALAR CODE
+class FabrikGlm
+{
+    public:
+
+    typedef float Scalar;
+    typedef glm::vec2 Vector;
+
+    static Scalar FromFloat(float value) { return value; }
+    static float ToFloat(Scalar value) { return value; }
+
+    static Scalar Sqrt(Scalar value) { return glm::sqrt(value); }
+    static Scalar Dot(Vector a, Vector b) { return glm::dot(a, b); }
+    static Scalar Cross(Vector a, Vector b) { return a.x*b.y - a.y*b.x; }
+    static Scalar Length(Vector v) { return glm::length(v); }
+    static Scalar LengthSqr(Vector v) { return glm::dot(v, v); }
+    static Scalar Distance(Vector a, Vector b) { return glm::distance(a, b); }
+    static Scalar DistanceSqr(Vector a, Vector b) { return glm::dot(a-b, a-b); }
+
+    // glm::normalize GIVES NaN FOR A ZERO VECTOR, THE CORE EXPECTS ZERO
+    static Vector Normalize(Vector v)
+    {
+        Scalar length = Length(v);
+        return length > 0 ? v*(1.0f/length) : Vector(0);
+    }
+
+    static Vector RotationFromDegrees(Scalar theta)
+    {
+        Scalar radians = glm::radians(theta);
+        return Vector(glm::cos(radians), glm::sin(radians));
+    }
+    static Scalar DegreesFromRotation(Vector rotation) { return glm::degrees(glm::atan(rotation.y, rotation.x)); }
+};
+
+#if GLM_CONFIG_SIMD == GLM_ENABLE && (GLM_ARCH & GLM_ARCH_SSE2_BIT)
+
+// ONE SSE REGISTER PER 2D VECTOR, z AND w STAY ZERO. glm's ALIGNED vec4
+// OPERATORS DO THE ARITHMETIC, THE CONSTRUCTORS GIVE IT THE x, y SHAPE THE
+// CORE BUILDS ITS VECTORS WITH.
+class FabrikGlmSimdVector : public glm::aligned_vec4
+{
+    public:
+
+    FabrikGlmSimdVector() {}
+    FabrikGlmSimdVector(float x, float y) : glm::aligned_vec4(x, y, 0.0f, 0.0f) {}
+    explicit FabrikGlmSimdVector(const glm::aligned_vec4& v) : glm::aligned_vec4(v) {}
+
+    FabrikGlmSimdVector& operator+=(const FabrikGlmSimdVector& b) { glm::aligned_vec4::operator+=(b); return *this; }
+    FabrikGlmSimdVector& operator-=(const FabrikGlmSimdVector& b) { glm::aligned_vec4::operator-=(b); return *this; }
+};
+
+// RESULTS STAY FabrikGlmSimdVector, SO a ? b : c-d HAS ONE TYPE
+inline FabrikGlmSimdVector operator+(const FabrikGlmSimdVector& a, const FabrikGlmSimdVector& b)
+{
+    return FabrikGlmSimdVector((const glm::aligned_vec4&)a + (const glm::aligned_vec4&)b);
+}
+
+inline FabrikGlmSimdVector operator-(const FabrikGlmSimdVector& a, const FabrikGlmSimdVector& b)
+{
+    return FabrikGlmSimdVector((const glm::aligned_vec4&)a - (const glm::aligned_vec4&)b);
+}
+
+inline FabrikGlmSimdVector operator*(const FabrikGlmSimdVector& v, float s)
+{
+    return FabrikGlmSimdVector((const glm::aligned_vec4&)v * s);
+}
+
+inline FabrikGlmSimdVector operator/(const FabrikGlmSimdVector& v, float s)
+{
+    return FabrikGlmSimdVector((const glm::aligned_vec4&)v / s);
+}
+
+// MATH BACKEND ON SSE THROUGH glm's SIMD HELPERS
+class FabrikGlmSimd
+{
+    public:
+
+    typedef float Scalar;
+    typedef FabrikGlmSimdVector Vector;
+
+    static Scalar FromFloat(float value) { return value; }
+    static float ToFloat(Scalar value) { return value; }
+
+    static Scalar Sqrt(Scalar value) { return _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(value))); }
+    static Scalar Dot(Vector a, Vector b) { return _mm_cvtss_f32(glm_vec4_dot(a.data, b.data)); }
+    static Scalar Cross(Vector a, Vector b) { return a.x*b.y - a.y*b.x; }
+    static Scalar Length(Vector v) { return _mm_cvtss_f32(glm_vec4_length(v.data)); }
+    static Scalar LengthSqr(Vector v) { return Dot(v, v); }
+    static Scalar Distance(Vector a, Vector b) { return _mm_cvtss_f32(glm_vec4_distance(a.data, b.data)); }
+    static Scalar DistanceSqr(Vector a, Vector b) { return LengthSqr(a-b); }
+
+    static Vector Normalize(Vector v)
+    {
+        glm_vec4 lengthSqr = glm_vec4_dot(v.data, v.data);
+        if(_mm_cvtss_f32(lengthSqr) > 0)
+        {
+            Vector result;
+            result.data = _mm_div_ps(v.data, _mm_sqrt_ps(lengthSqr));
+            return result;
+        }
+        return Vector(0.0f, 0.0f);
+    }
+
+    static Vector RotationFromDegrees(Scalar theta)
+    {
+        Scalar radians = glm::radians(theta);
+        return Vector(glm::cos(radians), glm::sin(radians));
+    }
+    static Scalar DegreesFromRotation(Vector rotation) { return glm::degrees(glm::atan(rotation.y, rotation.x)); }
+};
+
+#endif
+
+#endif
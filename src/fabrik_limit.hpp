@@ -0,0 +1,222 @@
+#ifndef FABRIKPD2D_LIMIT_HPP
+#define FABRIKPD2D_LIMIT_HPP
+
+#include <cstdint>
+
+#include "fabrik_precision.hpp"
+
+// ROTATE v BY THE UNIT COMPLEX rotation = (cos, sin)
+template<class V>
+inline V RotateBy(V v, V rotation)
+{
+    return V{v.x*rotation.x - v.y*rotation.y, v.x*rotation.y + v.y*rotation.x};
+}
+
+template<class V>
+inline V RotateByInverse(V v, V rotation)
+{
+    return V{v.x*rotation.x + v.y*rotation.y, v.y*rotation.x - v.x*rotation.y};
+}
+
+// DIRECTION OF child IN THE FRAME OF parent, UNNORMALIZED
+template<class V>
+inline V LocalDirection(V parent, V child)
+{
+    return V{parent.x*child.x + parent.y*child.y, parent.x*child.y - parent.y*child.x};
+}
+
+// DEGREES ONLY CROSS THE PUBLIC API, EVERYTHING INSIDE IS A UNIT COMPLEX
+inline FabrikVec2 RotationFromDegrees(float theta)
+{
+    return FabrikFloat::RotationFromDegrees(theta);
+}
+
+inline float DegreesFromRotation(FabrikVec2 rotation)
+{
+    return FabrikFloat::DegreesFromRotation(rotation);
+}
+
+// JOINT LIMIT KERNEL SHARED BY EVERY SOLVER, SO A LIMITED JOINT BEHAVES THE
+// SAME WHATEVER CHAIN TYPE IT IS IN. INLINE, IT RUNS FOR EVERY BONE AND PASS.
+// P IS THE PRECISION POLICY, SEE fabrik_precision.hpp.
+template<class P>
+class FabrikBasicLimit
+{
+    public:
+
+    typedef typename P::Scalar S;
+    typedef typename P::Vector V;
+
+    FabrikBasicLimit();
+
+    void Set(S minTheta, S maxTheta);
+    S GetMinTheta() const;
+    S GetMaxTheta() const;
+
+    // LIMIT DIRECTIONS, MEANINGLESS WHEN IsFree()
+    V GetMinDir() const;
+    V GetMaxDir() const;
+    bool IsFree() const;
+
+    // theta, AN ANGLE READ BACK FROM A ROTATION, IN THE DEGREES OF THE LIMIT:
+    // UNCHANGED INSIDE [min, max], OTHERWISE THE TURN OF IT CLOSEST TO THE
+    // ARC, SO ROUNDING AT A LIMIT STAYS AT THAT LIMIT. A POSE SET AT 200
+    // UNDER [90, 270] READS 200, NOT -160.
+    S Unwrap(S theta) const;
+
+    // WHICH LIMIT A VIOLATION CLAMPS TO FOR A JOINT AT rotation. THE ANSWER
+    // IS STATE OF THE POSE, NOT OF THE LIMIT: THE OWNER OF THE ROTATIONS KEEPS
+    // IT NEXT TO THEM SO ONE LIMIT CAN SERVE MANY POSES.
+    bool PreferMin(V rotation) const;
+
+    bool Contains(V local) const;
+    // true AND THE LIMIT ON THE PREFERRED SIDE WHEN local IS OUTSIDE
+    bool Constrain(V local, bool preferMin, V& limit) const;
+    // LIKE Constrain BUT CLAMPS TO THE CLOSER LIMIT, IGNORING THE PREFERRED SIDE
+    bool Nearest(V local, V& limit) const;
+
+    private:
+
+    S mMinTheta;
+    S mMaxTheta;
+
+    // LIMITS AS UNIT DIRECTIONS, REFRESHED WHEN MIN/MAX CHANGE
+    V mMinDir;
+    V mMaxDir;
+    V mMidDir;
+    S mWidth; // ARC FROM MIN TO MAX, IN (0, 360]
+
+    friend class FabrikBatch;
+};
+
+// THE PRECISION OF FabrikPD2D
+typedef FabrikBasicLimit<FabrikFloat> FabrikLimit;
+
+template<class P>
+FabrikBasicLimit<P>::FabrikBasicLimit()
+{
+    Set(S(-180), S(180));
+}
+
+template<class P>
+void FabrikBasicLimit<P>::Set(S minTheta, S maxTheta)
+{
+    mMinTheta = minTheta;
+    mMaxTheta = maxTheta;
+
+    while(minTheta < S(0))
+    {
+        minTheta += S(360);
+    }
+    while(maxTheta <= minTheta)
+    {
+        maxTheta += S(360);
+    }
+
+    mWidth = maxTheta-minTheta;
+    mMinDir = P::RotationFromDegrees(mMinTheta);
+    mMaxDir = P::RotationFromDegrees(mMaxTheta);
+    mMidDir = P::RotationFromDegrees(mMinTheta+mWidth/S(2));
+}
+
+template<class P>
+typename P::Scalar FabrikBasicLimit<P>::GetMinTheta() const
+{
+    return mMinTheta;
+}
+
+template<class P>
+typename P::Scalar FabrikBasicLimit<P>::GetMaxTheta() const
+{
+    return mMaxTheta;
+}
+
+template<class P>
+typename P::Vector FabrikBasicLimit<P>::GetMinDir() const
+{
+    return mMinDir;
+}
+
+template<class P>
+typename P::Vector FabrikBasicLimit<P>::GetMaxDir() const
+{
+    return mMaxDir;
+}
+
+template<class P>
+bool FabrikBasicLimit<P>::IsFree() const
+{
+    return mWidth >= S(360);
+}
+
+template<class P>
+typename P::Scalar FabrikBasicLimit<P>::Unwrap(S theta) const
+{
+    if(theta >= mMinTheta && theta <= mMaxTheta)
+    {
+        return theta;
+    }
+    while(theta < mMinTheta)
+    {
+        theta += S(360);
+    }
+    while(theta >= mMinTheta+S(360))
+    {
+        theta -= S(360);
+    }
+    if(theta > mMaxTheta && theta-mMaxTheta > mMinTheta+S(360)-theta)
+    {
+        theta -= S(360);
+    }
+    return theta;
+}
+
+template<class P>
+bool FabrikBasicLimit<P>::PreferMin(V rotation) const
+{
+    if(Contains(rotation))
+    {
+        // CLOSER TO MIN WHEN BEFORE THE MIDDLE OF THE ARC
+        return P::Cross(rotation, mMidDir) > S(0);
+    }
+    return P::Dot(rotation, mMinDir) > P::Dot(rotation, mMaxDir);
+}
+
+template<class P>
+bool FabrikBasicLimit<P>::Contains(V local) const
+{
+    if(mWidth >= S(360))
+    {
+        return true;
+    }
+    if(mWidth <= S(180))
+    {
+        return P::Cross(mMinDir, local) >= S(0) && P::Cross(local, mMaxDir) >= S(0);
+    }
+    // THE FORBIDDEN ARC IS UNDER 180, TEST THAT INSTEAD
+    return !(P::Cross(mMaxDir, local) > S(0) && P::Cross(local, mMinDir) > S(0));
+}
+
+template<class P>
+bool FabrikBasicLimit<P>::Constrain(V local, bool preferMin, V& limit) const
+{
+    if(Contains(local))
+    {
+        return false;
+    }
+    limit = preferMin ? mMinDir : mMaxDir;
+    return true;
+}
+
+template<class P>
+bool FabrikBasicLimit<P>::Nearest(V local, V& limit) const
+{
+    if(Contains(local))
+    {
+        return false;
+    }
+    limit = P::Dot(local, mMinDir) > P::Dot(local, mMaxDir) ? mMinDir : mMaxDir;
+    return true;
+}
+
+#endif
@@ -0,0 +1,261 @@
+#ifndef FABRIKPD2D_PRECISION_HPP
+#define FABRIKPD2D_PRECISION_HPP
+
+#include <cmath>
+#include <cstdint>
+
+#include "fabrik_vector.hpp"
+
+// SCALAR/VECTOR POLICIES FOR THE SOLVER CORE (FabrikBasicLimit, THE REACH
+// KERNELS AND FabrikChain). A POLICY NAMES ITS Scalar AND Vector TYPES, WHICH
+// SUPPORT + - * / AND CONSTRUCTION FROM SMALL INTEGERS, AND PROVIDES THE FEW
+// FUNCTIONS THE CORE NEEDS ON TOP OF THAT. THE SAME INTERFACE PLUGS IN OTHER
+// MATH LIBRARIES, SEE fabrik_raylib.hpp AND fabrik_glm.hpp.
+
+// float ON THE CORE FabrikVec2, THE PRECISION OF FabrikPD2D. THE FORMULAS ARE
+// raymath's, SO IT GIVES THE SAME BITS AS THE raylib BACKEND.
+class FabrikFloat
+{
+    public:
+
+    typedef float Scalar;
+    typedef FabrikVec2 Vector;
+
+    static Scalar FromFloat(float value) { return value; }
+    static float ToFloat(Scalar value) { return value; }
+
+    static Scalar Sqrt(Scalar value) { return sqrtf(value); }
+    static Scalar Dot(Vector a, Vector b) { return a.x*b.x + a.y*b.y; }
+    static Scalar Cross(Vector a, Vector b) { return a.x*b.y - a.y*b.x; }
+    static Scalar Length(Vector v) { return sqrtf((v.x*v.x) + (v.y*v.y)); }
+    static Scalar LengthSqr(Vector v) { return (v.x*v.x) + (v.y*v.y); }
+    static Scalar Distance(Vector a, Vector b) { return sqrtf((a.x - b.x)*(a.x - b.x) + (a.y - b.y)*(a.y - b.y)); }
+    static Scalar DistanceSqr(Vector a, Vector b) { return (a.x - b.x)*(a.x - b.x) + (a.y - b.y)*(a.y - b.y); }
+
+    static Vector Normalize(Vector v)
+    {
+        float length = Length(v);
+        if(length > 0)
+        {
+            float inverse = 1.0f/length;
+            return Vector{v.x*inverse, v.y*inverse};
+        }
+        return Vector{0, 0};
+    }
+
+    static Vector RotationFromDegrees(Scalar theta)
+    {
+        const float toRadians = 3.14159265358979323846f/180.0f;
+        return Vector{cosf(toRadians*theta), sinf(toRadians*theta)};
+    }
+    static Scalar DegreesFromRotation(Vector rotation)
+    {
+        const float toDegrees = 180.0f/3.14159265358979323846f;
+        return toDegrees*atan2f(rotation.y, rotation.x);
+    }
+};
+
+// double FOR OFFLINE BAKING OF LONG CHAINS
+class FabrikDouble
+{
+    public:
+
+    typedef double Scalar;
+    typedef FabrikVector2<double> Vector;
+
+    static Scalar FromFloat(float value) { return value; }
+    static float ToFloat(Scalar value) { return (float)value; }
+
+    static Scalar Sqrt(Scalar value) { return std::sqrt(value); }
+    static Scalar Dot(Vector a, Vector b) { return a.x*b.x + a.y*b.y; }
+    static Scalar Cross(Vector a, Vector b) { return a.x*b.y - a.y*b.x; }
+    static Scalar Length(Vector v) { return std::sqrt(v.x*v.x + v.y*v.y); }
+    static Scalar LengthSqr(Vector v) { return v.x*v.x + v.y*v.y; }
+    static Scalar Distance(Vector a, Vector b) { return Length(a-b); }
+    static Scalar DistanceSqr(Vector a, Vector b) { return LengthSqr(a-b); }
+
+    static Vector Normalize(Vector v)
+    {
+        Scalar length = Length(v);
+        return length > 0 ? v*(1/length) : v;
+    }
+
+    static Vector RotationFromDegrees(Scalar theta)
+    {
+        Scalar radians = theta*(3.14159265358979323846/180);
+        return Vector{std::cos(radians), std::sin(radians)};
+    }
+    static Scalar DegreesFromRotation(Vector rotation)
+    {
+        return std::atan2(rotation.y, rotation.x)*(180/3.14159265358979323846);
+    }
+};
+
+// SIGNED FIXED POINT WITH 16 FRACTIONAL BITS, STORED IN 64 BITS. EVERYTHING
+// IS INTEGER ARITHMETIC, SO THE SAME INPUTS GIVE THE SAME BITS ON EVERY
+// MACHINE. THE OPERANDS OF A PRODUCT MUST STAY UNDER ~46000 IN MAGNITUDE.
+class FabrikQ16
+{
+    public:
+
+    static constexpr int SHIFT = 16;
+    static constexpr int64_t ONE = (int64_t)1 << SHIFT;
+
+    FabrikQ16() : mRaw(0) {}
+    FabrikQ16(int value) : mRaw((int64_t)value*ONE) {}
+
+    static FabrikQ16 FromRaw(int64_t raw) { FabrikQ16 result; result.mRaw = raw; return result; }
+    static FabrikQ16 FromFloat(float value) { return FromRaw(llround((double)value*ONE)); }
+    float ToFloat() const { return (float)((double)mRaw/ONE); }
+    int64_t GetRaw() const { return mRaw; }
+
+    FabrikQ16 operator-() const { return FromRaw(-mRaw); }
+    FabrikQ16 operator+(FabrikQ16 b) const { return FromRaw(mRaw+b.mRaw); }
+    FabrikQ16 operator-(FabrikQ16 b) const { return FromRaw(mRaw-b.mRaw); }
+    FabrikQ16 operator*(FabrikQ16 b) const { return FromRaw((mRaw*b.mRaw) >> SHIFT); }
+    // DIVIDING BY ZERO GIVES ZERO INSTEAD OF TRAPPING
+    FabrikQ16 operator/(FabrikQ16 b) const { return b.mRaw != 0 ? FromRaw(mRaw*ONE/b.mRaw) : FabrikQ16(); }
+
+    FabrikQ16& operator+=(FabrikQ16 b) { mRaw += b.mRaw; return *this; }
+    FabrikQ16& operator-=(FabrikQ16 b) { mRaw -= b.mRaw; return *this; }
+
+    bool operator<(FabrikQ16 b) const { return mRaw < b.mRaw; }
+    bool operator>(FabrikQ16 b) const { return mRaw > b.mRaw; }
+    bool operator<=(FabrikQ16 b) const { return mRaw <= b.mRaw; }
+    bool operator>=(FabrikQ16 b) const { return mRaw >= b.mRaw; }
+    bool operator==(FabrikQ16 b) const { return mRaw == b.mRaw; }
+    bool operator!=(FabrikQ16 b) const { return mRaw != b.mRaw; }
+
+    private:
+
+    int64_t mRaw;
+};
+
+// DETERMINISTIC FIXED POINT FOR LOCKSTEP SIMULATION: INTEGER SQUARE ROOT AND
+// POLYNOMIAL SINE/ATAN, NO FLOATING POINT ANYWHERE IN THE SOLVE
+class FabrikFixed
+{
+    public:
+
+    typedef FabrikQ16 Scalar;
+    typedef FabrikVector2<FabrikQ16> Vector;
+
+    static Scalar FromFloat(float value) { return FabrikQ16::FromFloat(value); }
+    static float ToFloat(Scalar value) { return value.ToFloat(); }
+
+    static Scalar Sqrt(Scalar value)
+    {
+        if(value.GetRaw() <= 0)
+        {
+            return Scalar();
+        }
+        // sqrt(raw/ONE)*ONE == sqrt(raw*ONE), BIT BY BIT
+        uint64_t n = (uint64_t)value.GetRaw() << FabrikQ16::SHIFT;
+        uint64_t root = 0;
+#if defined(__GNUC__) || defined(__clang__)
+        // HIGHEST EVEN BIT AT OR BELOW THE TOP BIT OF n
+        uint64_t bit = (uint64_t)1 << ((63-__builtin_clzll(n)) & ~1);
+#else
+        uint64_t bit = (uint64_t)1 << 62;
+        while(bit > n)
+        {
+            bit >>= 2;
+        }
+#endif
+        while(bit != 0)
+        {
+            if(n >= root+bit)
+            {
+                n -= root+bit;
+                root = (root >> 1)+bit;
+            }
+            else
+            {
+                root >>= 1;
+            }
+            bit >>= 2;
+        }
+        return FabrikQ16::FromRaw((int64_t)root);
+    }
+
+    static Scalar Dot(Vector a, Vector b) { return a.x*b.x + a.y*b.y; }
+    static Scalar Cross(Vector a, Vector b) { return a.x*b.y - a.y*b.x; }
+    static Scalar Length(Vector v) { return Sqrt(v.x*v.x + v.y*v.y); }
+    static Scalar LengthSqr(Vector v) { return v.x*v.x + v.y*v.y; }
+    static Scalar Distance(Vector a, Vector b) { return Length(a-b); }
+    static Scalar DistanceSqr(Vector a, Vector b) { return LengthSqr(a-b); }
+
+    static Vector Normalize(Vector v)
+    {
+        Scalar length = Length(v);
+        return length > 0 ? v/length : v;
+    }
+
+    static Vector RotationFromDegrees(Scalar theta)
+    {
+        return Vector{SinDegrees(theta+90), SinDegrees(theta)};
+    }
+
+    static Scalar DegreesFromRotation(Vector rotation)
+    {
+        Scalar ax = rotation.x < 0 ? -rotation.x : rotation.x;
+        Scalar ay = rotation.y < 0 ? -rotation.y : rotation.y;
+        if(ax == 0 && ay == 0)
+        {
+            return Scalar();
+        }
+
+        // FIRST OCTANT, THEN UNFOLD
+        bool steep = ay > ax;
+        Scalar angle = AtanDegrees(steep ? ax/ay : ay/ax);
+        if(steep)
+        {
+            angle = Scalar(90)-angle;
+        }
+        if(rotation.x < 0)
+        {
+            angle = Scalar(180)-angle;
+        }
+        return rotation.y < 0 ? -angle : angle;
+    }
+
+    private:
+
+    static Scalar SinDegrees(Scalar theta)
+    {
+        // INTO [0, 360), THEN A QUARTER WAVE
+        const int64_t turn = 360*FabrikQ16::ONE;
+        int64_t raw = theta.GetRaw() % turn;
+        if(raw < 0)
+        {
+            raw += turn;
+        }
+        const int64_t quarter = 90*FabrikQ16::ONE;
+        bool negative = raw >= 2*quarter;
+        if(negative)
+        {
+            raw -= 2*quarter;
+        }
+        if(raw > quarter)
+        {
+            raw = 2*quarter-raw;
+        }
+
+        // sin(t*pi/2) FOR t IN [0, 1], TAYLOR TO t^9 (ERROR UNDER 4e-6)
+        Scalar t = FabrikQ16::FromRaw(raw)/Scalar(90);
+        Scalar t2 = t*t;
+        Scalar result = t*(FabrikQ16::FromRaw(102944) + t2*(FabrikQ16::FromRaw(-42334) + t2*(FabrikQ16::FromRaw(5223)
+            + t2*(FabrikQ16::FromRaw(-307) + t2*FabrikQ16::FromRaw(11)))));
+        return negative ? -result : result;
+    }
+
+    static Scalar AtanDegrees(Scalar t)
+    {
+        // atan(t) IN DEGREES FOR t IN [0, 1], MINIMAX POLYNOMIAL (ERROR UNDER 1e-5 RAD)
+        Scalar t2 = t*t;
+        return t*(FabrikQ16::FromRaw(3754851) + t2*(FabrikQ16::FromRaw(-1248980) + t2*(FabrikQ16::FromRaw(726743)
+            + t2*(FabrikQ16::FromRaw(-437198) + t2*(FabrikQ16::FromRaw(197710) + t2*FabrikQ16::FromRaw(-44012))))));
+    }
+};
+
+#endif
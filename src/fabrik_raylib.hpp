@@ -0,0 +1,49 @@
+#ifndef FABRIKPD2D_RAYLIB_HPP
+#define FABRIKPD2D_RAYLIB_HPP
+
+#include <cmath>
+
+#include <raylib/raylib.h>
+#include <raylib/raymath.h>
+
+#include "fabrik_vector.hpp"
+
+// raylib ADAPTER, THE ONLY PART OF THE SOLVER THAT INCLUDES raylib
+
+inline Vector2 FabrikToRaylib(FabrikVec2 v)
+{
+    return Vector2{v.x, v.y};
+}
+
+inline FabrikVec2 FabrikFromRaylib(Vector2 v)
+{
+    return FabrikVec2{v.x, v.y};
+}
+
+// MATH BACKEND ON raylib's Vector2 AND raymath, TRIG THROUGH ONE cosf/sinf/
+// atan2f CALL EACH TIME LIKE raymath's HELPERS. USE AS THE PRECISION OF
+// FabrikChain<N, Policy, FabrikRaylib>, SEE fabrik_precision.hpp.
+class FabrikRaylib
+{
+    public:
+
+    typedef float Scalar;
+    typedef Vector2 Vector;
+
+    static Scalar FromFloat(float value) { return value; }
+    static float ToFloat(Scalar value) { return value; }
+
+    static Scalar Sqrt(Scalar value) { return sqrtf(value); }
+    static Scalar Dot(Vector a, Vector b) { return Vector2DotProduct(a, b); }
+    static Scalar Cross(Vector a, Vector b) { return Vector2CrossProduct(a, b); }
+    static Scalar Length(Vector v) { return Vector2Length(v); }
+    static Scalar LengthSqr(Vector v) { return Vector2LengthSqr(v); }
+    static Scalar Distance(Vector a, Vector b) { return Vector2Distance(a, b); }
+    static Scalar DistanceSqr(Vector a, Vector b) { return Vector2DistanceSqr(a, b); }
+    static Vector Normalize(Vector v) { return Vector2Normalize(v); }
+
+    static Vector RotationFromDegrees(Scalar theta) { return Vector2{cosf(DEG2RAD*theta), sinf(DEG2RAD*theta)}; }
+    static Scalar DegreesFromRotation(Vector rotation) { return RAD2DEG*atan2f(rotation.y, rotation.x); }
+};
+
+#endif
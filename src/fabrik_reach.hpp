@@ -0,0 +1,361 @@
+#ifndef FABRIKPD2D_REACH_HPP
+#define FABRIKPD2D_REACH_HPP
+
+#include <cmath>
+#include <cstdint>
+
+#include "fabrik_limit.hpp"
+#include "fabrik_precision.hpp"
+
+// THE REACHING PASSES OF A SINGLE END SOLVE, SHARED BY FabrikPD2D AND
+// FabrikChain<N> SO BOTH GIVE THE SAME RESULT. LIMITS == false DROPS EVERY
+// CONSTRAINT CHECK FOR CHAINS KNOWN TO HAVE NONE. P IS THE PRECISION POLICY.
+
+// HOW A REACH ENDED AND WHAT IT COST. THE KERNELS ADD TO mIterations AND
+// mClamps AND SET mTermination, THE CALLER CLEARS THEM.
+class FabrikReachStats
+{
+    public:
+
+    enum Termination
+    {
+        TERMINATION_NONE, // NOT SOLVED, THE EFFECTOR IS NOT ON THE RIG
+        TERMINATION_SKIPPED, // NOTHING CHANGED, THE POSE WAS KEPT
+        TERMINATION_CONVERGED, // WITHIN THE THRESHOLD OF THE TARGET
+        TERMINATION_STALLED, // MOVED LESS THAN THE ITERATION THRESHOLD
+        TERMINATION_ITERATION_LIMIT,
+        TERMINATION_CLOSED_FORM, // OUT OF REACH, OR ONE OR TWO BONES
+        TERMINATION_COUNT
+    };
+
+    uint32_t mIterations;
+    uint32_t mClamps;
+    Termination mTermination;
+};
+
+// ONE ACTIVE SUB-CHAIN: mNodes JOINTS, mPositions[0] IS THE START OF ITS FIRST BONE
+// AND mPositions[mNodes-1] THE EFFECTOR. mLengths[i], mLimits[i] AND
+// mPreferMin[i] BELONG TO THE BONE STARTING AT JOINT i.
+template<class P>
+class FabrikBasicReachView
+{
+    public:
+
+    typename P::Vector* mPositions;
+    const typename P::Scalar* mLengths;
+    const FabrikBasicLimit<P>* mLimits;
+    const uint8_t* mPreferMin; // SIDE EACH LIMIT CLAMPS TO, SEE FabrikBasicLimit::PreferMin
+    uint32_t mNodes;
+
+    typename P::Vector mBaseStart;
+    typename P::Vector mBaseDirection; // PARENT DIRECTION OF THE FIRST BONE
+    typename P::Scalar mReach; // SUM OF THE ACTIVE LENGTHS
+
+    typename P::Scalar mThreshold;
+    typename P::Scalar mIterationThreshold;
+    uint32_t mIterationLimit;
+
+    FabrikReachStats* mStats; // NEVER nullptr
+};
+
+typedef FabrikBasicReachView<FabrikFloat> FabrikReachView;
+
+// DIRECTION OF A BONE FROM start TOWARD target, CLAMPED BY ITS LIMIT
+template<bool LIMITS, class P>
+typename P::Vector FabrikAimBone(const FabrikBasicLimit<P>& bone, bool preferMin, typename P::Vector parent, typename P::Vector start, typename P::Vector target, uint32_t& clamps)
+{
+    typedef typename P::Scalar S;
+    typedef typename P::Vector V;
+
+    // A TARGET ON THE JOINT GIVES NO DIRECTION, KEEP THE BONE STRAIGHT
+    V direction = target-start;
+    direction = P::LengthSqr(direction) > S(0) ? P::Normalize(direction) : P::Normalize(parent);
+
+    V limit;
+    if(LIMITS && bone.Constrain(LocalDirection(parent, direction), preferMin, limit))
+    {
+        direction = RotateBy(P::Normalize(parent), limit);
+        ++clamps;
+    }
+    return direction;
+}
+
+// LAYS THE CHAIN OUT TOWARD A TARGET BEYOND ITS REACH IN ONE PASS, RETURNS
+// false WHEN THE TARGET IS REACHABLE OR THE LIMITS FORBID THE STRAIGHT LINE,
+// AND NOTHING WAS DONE
+template<bool LIMITS, class P>
+bool FabrikReachStraight(const FabrikBasicReachView<P>& v, typename P::Vector target)
+{
+    typedef typename P::Scalar S;
+    typedef typename P::Vector V;
+
+    uint32_t numberOfNodes = v.mNodes;
+    if(numberOfNodes < 2)
+    {
+        return false;
+    }
+
+    V* positions = v.mPositions;
+
+    // THE ITERATIONS WOULD NOT START EITHER
+    if(P::Distance(positions[numberOfNodes-1], target) <= v.mThreshold)
+    {
+        return false;
+    }
+    if(P::DistanceSqr(v.mBaseStart, target) <= v.mReach*v.mReach)
+    {
+        return false;
+    }
+
+    // FABRIK CONVERGES TO EVERY BONE POINTING AT THE TARGET. WITH LIMITS THAT
+    // LINE IS ONLY THE ANSWER WHEN THEY ALLOW IT: THE FIRST BONE TURNS FROM
+    // ITS PARENT AND THE OTHERS STAY STRAIGHT. A GREEDY PASS CLAMPING BONE
+    // BY BONE CAN END FAR WORSE THAN THE ITERATIONS, SO THEY ARE LEFT TO RUN.
+    if(LIMITS)
+    {
+        V direction = P::Normalize(target-v.mBaseStart);
+        if(!v.mLimits[0].Contains(LocalDirection(v.mBaseDirection, direction)))
+        {
+            return false;
+        }
+        for(uint32_t i = 1; i < numberOfNodes-1; i++)
+        {
+            if(!v.mLimits[i].Contains(V{S(1), S(0)}))
+            {
+                return false;
+            }
+        }
+    }
+
+    V a = v.mBaseDirection;
+    positions[0] = v.mBaseStart;
+    for(uint32_t i = 0; i < numberOfNodes-1; i++)
+    {
+        V b = FabrikAimBone<LIMITS>(v.mLimits[i], v.mPreferMin[i] != 0, a, positions[i], target, v.mStats->mClamps);
+        positions[i+1] = positions[i]+b*v.mLengths[i];
+        a = b;
+    }
+    v.mStats->mTermination = FabrikReachStats::TERMINATION_CLOSED_FORM;
+    return true;
+}
+
+// EXACT SOLVE FOR SUB-CHAINS OF ONE OR TWO BONES, false FOR LONGER ONES
+template<bool LIMITS, class P>
+bool FabrikReachAnalytic(const FabrikBasicReachView<P>& v, typename P::Vector target)
+{
+    typedef typename P::Scalar S;
+    typedef typename P::Vector V;
+
+    uint32_t bones = v.mNodes-1;
+    if(bones < 1 || bones > 2)
+    {
+        return false;
+    }
+
+    V* positions = v.mPositions;
+    const S* lengths = v.mLengths;
+
+    if(P::Distance(positions[bones], target) <= v.mThreshold)
+    {
+        return false;
+    }
+
+    V baseStart = v.mBaseStart;
+    V baseDirection = v.mBaseDirection;
+    positions[0] = baseStart;
+    v.mStats->mTermination = FabrikReachStats::TERMINATION_CLOSED_FORM;
+
+    if(bones == 1)
+    {
+        positions[1] = baseStart+FabrikAimBone<LIMITS>(v.mLimits[0], v.mPreferMin[0] != 0, baseDirection, baseStart, target, v.mStats->mClamps)*lengths[0];
+        return true;
+    }
+
+    // TWO BONES: THE ELBOW IS AT ANGLE A FROM THE BASE-TARGET LINE, LAW OF COSINES.
+    // TARGETS OUT OF REACH ONLY GET HERE WHEN LIMITS KEEP THE PAIR FROM LYING
+    // STRAIGHT, SEE FabrikReachStraight. THEIR cosA IS CLAMPED.
+    S l1 = lengths[0];
+    S l2 = lengths[1];
+    V toTarget = target-baseStart;
+    S d = P::Length(toTarget);
+    V direction = d > S(0) ? toTarget/d : P::Normalize(positions[1]-positions[0]);
+
+    S cosA = d > S(0) && l1 > S(0) ? (l1*l1 + d*d - l2*l2)/(S(2)*l1*d) : S(1);
+    cosA = cosA < S(-1) ? S(-1) : (cosA > S(1) ? S(1) : cosA);
+    S sinA = P::Sqrt(S(1)-cosA*cosA);
+
+    // KEEP THE CURRENT BEND: A COUNTER-CLOCKWISE ELBOW PUTS THE JOINT CLOCKWISE OF THE LINE
+    S side = P::Cross(positions[1]-positions[0], positions[2]-positions[1]) >= S(0) ? S(1) : S(-1);
+
+    const FabrikBasicLimit<P>& shoulder = v.mLimits[0];
+    const FabrikBasicLimit<P>& elbow = v.mLimits[1];
+    for(int bend = 0; bend < 2; bend++)
+    {
+        V u1 = RotateBy(direction, V{cosA, -side*sinA});
+        V p1 = baseStart+u1*l1;
+        V u2 = target-p1;
+        u2 = P::LengthSqr(u2) > S(0) ? P::Normalize(u2) : u1;
+
+        // THE PREFERRED BEND WINS WHEN BOTH ARE WITHIN LIMITS
+        if(!LIMITS || (shoulder.Contains(LocalDirection(baseDirection, u1)) && elbow.Contains(LocalDirection(u1, u2))))
+        {
+            positions[1] = p1;
+            positions[2] = p1+u2*l2;
+            return true;
+        }
+        side = -side;
+    }
+
+    // OTHERWISE THE CLOSEST POSE HAS A JOINT ON A LIMIT. ALONG EACH LIMIT THE
+    // DISTANCE HAS A SINGLE MINIMUM, SO AIMING AND CLAMPING TO THE NEARER END
+    // OF THE ARC FINDS IT, THE BEST OF THE FOUR EDGES IS THE ANSWER.
+    V best1 = direction;
+    V best2 = direction;
+    S bestError = S(-1);
+    uint32_t bestClamps = 0;
+    for(int edge = 0; edge < 4; edge++)
+    {
+        V c1;
+        V c2;
+        uint32_t clamps = 1;
+        if(edge < 2)
+        {
+            // SHOULDER ON A LIMIT, THE ELBOW AIMS
+            if(shoulder.IsFree())
+            {
+                continue;
+            }
+            c1 = RotateBy(baseDirection, edge == 0 ? shoulder.GetMinDir() : shoulder.GetMaxDir());
+            V p1 = baseStart+c1*l1;
+            V aim = target-p1;
+            c2 = P::LengthSqr(aim) > S(0) ? P::Normalize(aim) : c1;
+            V limit;
+            if(elbow.Nearest(LocalDirection(c1, c2), limit))
+            {
+                c2 = RotateBy(c1, limit);
+                ++clamps;
+            }
+        }
+        else
+        {
+            // ELBOW ON A LIMIT, THE NOW RIGID PAIR AIMS
+            if(elbow.IsFree())
+            {
+                continue;
+            }
+            V bend = edge == 2 ? elbow.GetMinDir() : elbow.GetMaxDir();
+            V pair = V{l1, S(0)}+bend*l2;
+            c1 = P::LengthSqr(pair) > S(0) ? RotateByInverse(direction, P::Normalize(pair)) : direction;
+            V limit;
+            if(shoulder.Nearest(LocalDirection(baseDirection, c1), limit))
+            {
+                c1 = RotateBy(baseDirection, limit);
+                ++clamps;
+            }
+            c2 = RotateBy(c1, bend);
+        }
+
+        S error = P::Distance(baseStart+c1*l1+c2*l2, target);
+        if(bestError < S(0) || error < bestError)
+        {
+            best1 = c1;
+            best2 = c2;
+            bestError = error;
+            bestClamps = clamps;
+        }
+    }
+
+    v.mStats->mClamps += bestClamps;
+    positions[1] = baseStart+best1*l1;
+    positions[2] = positions[1]+best2*l2;
+    return true;
+}
+
+// THE ITERATIVE FORWARD/BACKWARD PASSES. NODES != 0 FIXES THE JOINT COUNT AT
+// COMPILE TIME SO THE PASSES CAN BE FULLY UNROLLED.
+template<bool LIMITS, uint32_t NODES, class P>
+void FabrikReachIterate(const FabrikBasicReachView<P>& v, typename P::Vector target)
+{
+    typedef typename P::Scalar S;
+    typedef typename P::Vector V;
+
+    const uint32_t numberOfNodes = NODES != 0 ? NODES : v.mNodes;
+
+    V* positions = v.mPositions;
+    const S* lengths = v.mLengths;
+    const FabrikBasicLimit<P>* limits = v.mLimits;
+    const uint8_t* preferMin = v.mPreferMin;
+
+    V prevEffectorStart = target;
+    uint32_t iterations = 0;
+    uint32_t clamps = 0;
+
+    while((P::Distance(positions[numberOfNodes-1], target) > v.mThreshold) && (P::Distance(positions[numberOfNodes-1], prevEffectorStart) > v.mIterationThreshold) && (iterations < v.mIterationLimit))
+    {
+        prevEffectorStart = positions[numberOfNodes-1];
+
+        // FORWARD REACHING
+        positions[numberOfNodes-1] = target;
+        for(int i = (int)numberOfNodes-2; i >= 0; i--)
+        {
+            S r = P::Distance(positions[i], positions[i+1]);
+            S lambda = lengths[i]/r;
+            positions[i] = positions[i+1]*(S(1)-lambda) + positions[i]*(lambda);
+
+            if(LIMITS && i < (int)numberOfNodes-2)
+            {
+                V a = positions[i+1]-positions[i];
+                V b = positions[i+2]-positions[i+1];
+                V limit;
+                if(limits[i].Constrain(LocalDirection(a, b), preferMin[i] != 0, limit))
+                {
+                    positions[i] = positions[i+1]-RotateByInverse(P::Normalize(b), limit)*lengths[i];
+                    ++clamps;
+                }
+            }
+        }
+
+        // BACKWARD REACHING
+        positions[0] = v.mBaseStart;
+        for(uint32_t i = 0; i+1 < numberOfNodes; i++)
+        {
+            S r = P::Distance(positions[i], positions[i+1]);
+            S lambda = lengths[i]/r;
+            positions[i+1] = positions[i]*(S(1)-lambda) + positions[i+1]*(lambda);
+
+            if(LIMITS)
+            {
+                V a = i == 0 ? v.mBaseDirection : positions[i]-positions[i-1];
+                V b = positions[i+1]-positions[i];
+
+                V limit;
+                if(limits[i].Constrain(LocalDirection(a, b), preferMin[i] != 0, limit))
+                {
+                    positions[i+1] = positions[i]+RotateBy(P::Normalize(a), limit)*lengths[i];
+                    ++clamps;
+                }
+            }
+        }
+
+        ++iterations;
+    }
+
+    // THE FIRST OF THE LOOP CONDITIONS THAT FAILED
+    FabrikReachStats& stats = *v.mStats;
+    stats.mIterations += iterations;
+    stats.mClamps += clamps;
+    if(P::Distance(positions[numberOfNodes-1], target) <= v.mThreshold)
+    {
+        stats.mTermination = FabrikReachStats::TERMINATION_CONVERGED;
+    }
+    else if(P::Distance(positions[numberOfNodes-1], prevEffectorStart) <= v.mIterationThreshold)
+    {
+        stats.mTermination = FabrikReachStats::TERMINATION_STALLED;
+    }
+    else
+    {
+        stats.mTermination = FabrikReachStats::TERMINATION_ITERATION_LIMIT;
+    }
+}
+
+#endif
@@ -0,0 +1,772 @@
+#include "fabrik_rig.hpp"
+#include "fabrik_limit.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+#include <rapidjson/document.h>
+#include <rapidjson/error/en.h>
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/stringbuffer.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// LIMITS ARE STORED AS THEY ARE IN MEMORY, DIRECTIONS INCLUDED, SO LOADING
+// NEEDS NO TRIG
+static_assert(std::is_trivially_copyable<FabrikLimit>::value, "FabrikLimit is copied as bytes");
+static_assert(sizeof(FabrikVec2) == 8, "FabrikVec2 is stored as two floats");
+
+static const char RIG_MAGIC[4] = {'F', 'R', 'I', 'G'};
+static const uint32_t RIG_VERSION = 2;
+static const uint32_t RIG_BYTE_ORDER = 0x01020304;
+static const uint64_t RIG_ALIGNMENT = 16;
+
+// PACK LAYOUT: THIS HEADER, mCount RIG OFFSETS, THEN THE RIGS. EVERY RIG IS
+// A FabrikRigHeader FOLLOWED BY ITS ARRAYS, ALL OFFSETS ARE 16 BYTE ALIGNED.
+class FabrikRigPackHeader
+{
+    public:
+
+    char mMagic[4];
+    uint32_t mVersion;
+    uint32_t mByteOrder;
+    uint32_t mLimitSize;
+    uint32_t mCount;
+    uint32_t mReserved;
+    uint64_t mSize;
+};
+
+// OFFSETS ARE FROM THE RIG HEADER, EVERY ARRAY HAS mJoints ENTRIES AND IS
+// INDEXED BY BONE, [0] BEING THE BASE, AS IN FabrikPD2D
+class FabrikRigHeader
+{
+    public:
+
+    uint32_t mJoints;
+    uint32_t mBranched;
+    FabrikVec2 mBasePosition;
+    FabrikVec2 mBaseRotation;
+    float mBaseTheta;
+    uint32_t mIterationLimit;
+    float mIterationThreshold;
+    float mThreshold;
+    float mTargetEpsilon;
+    uint32_t mReserved;
+
+    uint64_t mParents;
+    uint64_t mChildren;
+    uint64_t mSiblings;
+    uint64_t mLengths;
+    uint64_t mLengthSums;
+    uint64_t mRotations;
+    uint64_t mLimits;
+    uint64_t mPreferMin;
+    uint64_t mSize;
+};
+
+static uint64_t Align(uint64_t offset)
+{
+    return (offset+RIG_ALIGNMENT-1) & ~(RIG_ALIGNMENT-1);
+}
+
+template<class T>
+static const T* GetArray(const FabrikRigHeader* header, uint64_t offset)
+{
+    return reinterpret_cast<const T*>(reinterpret_cast<const uint8_t*>(header)+offset);
+}
+
+static bool CheckArray(const FabrikRigHeader* header, uint64_t offset, uint64_t elementSize)
+{
+    return offset >= sizeof(FabrikRigHeader) && offset%RIG_ALIGNMENT == 0 && offset <= header->mSize
+        && (header->mSize-offset)/elementSize >= header->mJoints;
+}
+
+FabrikRigImage::FabrikRigImage()
+    : mHeader(nullptr)
+{
+}
+
+uint32_t FabrikRigImage::GetBoneCount() const
+{
+    return mHeader != nullptr ? mHeader->mJoints-1 : 0;
+}
+
+std::shared_ptr<const FabrikPD2D::Definition> FabrikRigImage::LoadDefinition() const
+{
+    if(mHeader == nullptr)
+    {
+        return nullptr;
+    }
+
+    uint32_t joints = mHeader->mJoints;
+    const uint32_t* parents = GetArray<uint32_t>(mHeader, mHeader->mParents);
+    const uint32_t* children = GetArray<uint32_t>(mHeader, mHeader->mChildren);
+    const uint32_t* siblings = GetArray<uint32_t>(mHeader, mHeader->mSiblings);
+
+    // THE SOLVER INDEXES WITH THESE UNCHECKED: PARENTS BEFORE CHILDREN,
+    // LINKS FORWARD AND IN RANGE
+    if(parents[0] != 0 || siblings[0] != 0)
+    {
+        return nullptr;
+    }
+    bool branched = false;
+    for(uint32_t i = 0; i < joints; i++)
+    {
+        if((i > 0 && parents[i] >= i) || (children[i] != 0 && (children[i] <= i || children[i] >= joints))
+            || (siblings[i] != 0 && (siblings[i] <= i || siblings[i] >= joints)))
+        {
+            return nullptr;
+        }
+        branched = branched || siblings[i] != 0;
+    }
+
+    // A RIG IS BRANCHED ONCE A BONE HAS A SIBLING. THE LINEAR PATHS, THE
+    // SINGLE END FINISH AND FabrikScan, TAKE THE PARENT OF i TO BE i-1.
+    if(branched != (mHeader->mBranched != 0))
+    {
+        return nullptr;
+    }
+    for(uint32_t i = 1; i < joints && !branched; i++)
+    {
+        if(parents[i] != i-1 || children[i-1] != i)
+        {
+            return nullptr;
+        }
+    }
+
+    // THE REACH OF A SPAN IS A DIFFERENCE OF SUMS, THEY ARE CHECKED AGAINST
+    // THE LENGTHS AS FabrikPD2D ADDS THEM, NaN FAILING
+    const float* lengths = GetArray<float>(mHeader, mHeader->mLengths);
+    const float* lengthSums = GetArray<float>(mHeader, mHeader->mLengthSums);
+    if(lengths[0] != 0 || lengthSums[0] != 0)
+    {
+        return nullptr;
+    }
+    for(uint32_t i = 1; i < joints; i++)
+    {
+        if(!(lengthSums[i] == lengthSums[parents[i]]+lengths[i]))
+        {
+            return nullptr;
+        }
+    }
+
+    const FabrikVec2* rotations = GetArray<FabrikVec2>(mHeader, mHeader->mRotations);
+    const FabrikLimit* limits = GetArray<FabrikLimit>(mHeader, mHeader->mLimits);
+    const uint8_t* preferMin = GetArray<uint8_t>(mHeader, mHeader->mPreferMin);
+
+    std::shared_ptr<FabrikPD2D::Definition> definition = std::make_shared<FabrikPD2D::Definition>();
+    definition->mParents.assign(parents, parents+joints);
+    definition->mChildren.assign(children, children+joints);
+    definition->mSiblings.assign(siblings, siblings+joints);
+    definition->mBranched = mHeader->mBranched != 0;
+    definition->mLengths.assign(lengths, lengths+joints);
+    definition->mLengthSums.assign(lengthSums, lengthSums+joints);
+    definition->mLimits.assign(limits, limits+joints);
+    definition->mRotations.assign(rotations, rotations+joints);
+    definition->mPreferMin.assign(preferMin, preferMin+joints);
+    return definition;
+}
+
+bool FabrikRigImage::Load(FabrikPD2D& rig) const
+{
+    std::shared_ptr<const FabrikPD2D::Definition> definition = LoadDefinition();
+    if(definition == nullptr)
+    {
+        return false;
+    }
+
+    // NOBODY ELSE HAS SEEN IT YET, THE RIG MAY EDIT IT IN PLACE
+    rig.mDefinition = definition;
+    rig.mOwnsDefinition = true;
+
+    rig.mBasePosition = mHeader->mBasePosition;
+    rig.mBaseTheta = mHeader->mBaseTheta;
+    rig.mBaseRotation = mHeader->mBaseRotation;
+    rig.mIterationLimit = mHeader->mIterationLimit;
+    rig.mIterationThreshold = mHeader->mIterationThreshold;
+    rig.mThreshold = mHeader->mThreshold;
+    rig.mTargetEpsilon = mHeader->mTargetEpsilon;
+
+    rig.ResetPose();
+    return true;
+}
+
+FabrikRigPack::FabrikRigPack()
+    : mData(nullptr), mSize(0), mCount(0)
+{
+}
+
+bool FabrikRigPack::Open(const void* data, size_t size)
+{
+    Close();
+
+    const FabrikRigPackHeader* header = static_cast<const FabrikRigPackHeader*>(data);
+    if(data == nullptr || reinterpret_cast<uintptr_t>(data)%RIG_ALIGNMENT != 0 || size < sizeof(FabrikRigPackHeader)
+        || memcmp(header->mMagic, RIG_MAGIC, sizeof(RIG_MAGIC)) != 0 || header->mVersion != RIG_VERSION
+        || header->mByteOrder != RIG_BYTE_ORDER || header->mLimitSize != sizeof(FabrikLimit) || header->mSize > size
+        || (header->mSize-sizeof(FabrikRigPackHeader))/sizeof(uint64_t) < header->mCount)
+    {
+        return false;
+    }
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    const uint64_t* offsets = reinterpret_cast<const uint64_t*>(bytes+sizeof(FabrikRigPackHeader));
+    for(uint32_t r = 0; r < header->mCount; r++)
+    {
+        uint64_t offset = offsets[r];
+        if(offset%RIG_ALIGNMENT != 0 || offset > header->mSize || header->mSize-offset < sizeof(FabrikRigHeader))
+        {
+            return false;
+        }
+        const FabrikRigHeader* rig = reinterpret_cast<const FabrikRigHeader*>(bytes+offset);
+        if(rig->mJoints == 0 || rig->mSize > header->mSize-offset
+            || !CheckArray(rig, rig->mParents, sizeof(uint32_t)) || !CheckArray(rig, rig->mChildren, sizeof(uint32_t))
+            || !CheckArray(rig, rig->mSiblings, sizeof(uint32_t)) || !CheckArray(rig, rig->mLengths, sizeof(float))
+            || !CheckArray(rig, rig->mLengthSums, sizeof(float)) || !CheckArray(rig, rig->mRotations, sizeof(FabrikVec2))
+            || !CheckArray(rig, rig->mLimits, sizeof(FabrikLimit)) || !CheckArray(rig, rig->mPreferMin, sizeof(uint8_t)))
+        {
+            return false;
+        }
+    }
+
+    mData = bytes;
+    mSize = header->mSize;
+    mCount = header->mCount;
+    return true;
+}
+
+void FabrikRigPack::Close()
+{
+    mData = nullptr;
+    mSize = 0;
+    mCount = 0;
+}
+
+bool FabrikRigPack::IsOpen() const
+{
+    return mData != nullptr;
+}
+
+uint32_t FabrikRigPack::GetRigCount() const
+{
+    return mCount;
+}
+
+FabrikRigImage FabrikRigPack::GetRig(uint32_t rig) const
+{
+    FabrikRigImage image;
+    if(rig < mCount)
+    {
+        const uint64_t* offsets = reinterpret_cast<const uint64_t*>(mData+sizeof(FabrikRigPackHeader));
+        image.mHeader = reinterpret_cast<const FabrikRigHeader*>(mData+offsets[rig]);
+    }
+    return image;
+}
+
+void FabrikRigPack::Write(const std::vector<FabrikPD2D>& rigs, std::vector<uint8_t>& pack)
+{
+    // LAY OUT EVERYTHING FIRST SO THE PACK IS ALLOCATED ONCE
+    std::vector<FabrikRigHeader> headers(rigs.size());
+    std::vector<uint64_t> offsets(rigs.size());
+    uint64_t size = Align(sizeof(FabrikRigPackHeader)+rigs.size()*sizeof(uint64_t));
+    for(uint32_t r = 0; r < rigs.size(); r++)
+    {
+        const FabrikPD2D& rig = rigs[r];
+        FabrikRigHeader& header = headers[r];
+        memset(&header, 0, sizeof(header));
+
+        uint32_t joints = rig.mRotations.size();
+        header.mJoints = joints;
+        header.mBranched = rig.mDefinition->mBranched ? 1 : 0;
+        header.mBasePosition = rig.mBasePosition;
+        header.mBaseRotation = rig.mBaseRotation;
+        header.mBaseTheta = rig.mBaseTheta;
+        header.mIterationLimit = rig.mIterationLimit;
+        header.mIterationThreshold = rig.mIterationThreshold;
+        header.mThreshold = rig.mThreshold;
+        header.mTargetEpsilon = rig.mTargetEpsilon;
+
+        uint64_t offset = Align(sizeof(FabrikRigHeader));
+        header.mParents = offset;
+        offset = Align(offset+joints*sizeof(uint32_t));
+        header.mChildren = offset;
+        offset = Align(offset+joints*sizeof(uint32_t));
+        header.mSiblings = offset;
+        offset = Align(offset+joints*sizeof(uint32_t));
+        header.mLengths = offset;
+        offset = Align(offset+joints*sizeof(float));
+        header.mLengthSums = offset;
+        offset = Align(offset+joints*sizeof(float));
+        header.mRotations = offset;
+        offset = Align(offset+joints*sizeof(FabrikVec2));
+        header.mLimits = offset;
+        offset = Align(offset+joints*sizeof(FabrikLimit));
+        header.mPreferMin = offset;
+        offset = Align(offset+joints*sizeof(uint8_t));
+        header.mSize = offset;
+
+        offsets[r] = size;
+        size += offset;
+    }
+
+    pack.assign(size, 0);
+    FabrikRigPackHeader packHeader;
+    memset(&packHeader, 0, sizeof(packHeader));
+    memcpy(packHeader.mMagic, RIG_MAGIC, sizeof(RIG_MAGIC));
+    packHeader.mVersion = RIG_VERSION;
+    packHeader.mByteOrder = RIG_BYTE_ORDER;
+    packHeader.mLimitSize = sizeof(FabrikLimit);
+    packHeader.mCount = rigs.size();
+    packHeader.mSize = size;
+    memcpy(pack.data(), &packHeader, sizeof(packHeader));
+    if(!offsets.empty())
+    {
+        memcpy(pack.data()+sizeof(packHeader), offsets.data(), offsets.size()*sizeof(uint64_t));
+    }
+
+    for(uint32_t r = 0; r < rigs.size(); r++)
+    {
+        // THE BONES OF THE DEFINITION IN THE POSE OF THE INSTANCE, WHICH
+        // BECOMES THE REST POSE WHEN LOADED. A DEFERRED TAIL OR STALE
+        // ROTATIONS ARE BROUGHT UP TO DATE ON A COPY, rigs IS NOT TOUCHED.
+        std::unique_ptr<FabrikPD2D> followed;
+        if(rigs[r].mTailBone != 0 || rigs[r].mStaleBone != 0)
+        {
+            followed.reset(new FabrikPD2D(rigs[r]));
+            followed->UpdateRotations();
+        }
+        const FabrikPD2D& rig = followed ? *followed : rigs[r];
+        const FabrikPD2D::Definition& definition = *rig.mDefinition;
+        const FabrikRigHeader& header = headers[r];
+        uint8_t* base = pack.data()+offsets[r];
+        uint32_t joints = header.mJoints;
+        memcpy(base, &header, sizeof(header));
+        memcpy(base+header.mParents, definition.mParents.data(), joints*sizeof(uint32_t));
+        memcpy(base+header.mChildren, definition.mChildren.data(), joints*sizeof(uint32_t));
+        memcpy(base+header.mSiblings, definition.mSiblings.data(), joints*sizeof(uint32_t));
+        memcpy(base+header.mLengths, definition.mLengths.data(), joints*sizeof(float));
+        memcpy(base+header.mLengthSums, definition.mLengthSums.data(), joints*sizeof(float));
+        memcpy(base+header.mRotations, rig.mRotations.data(), joints*sizeof(FabrikVec2));
+        memcpy(base+header.mLimits, definition.mLimits.data(), joints*sizeof(FabrikLimit));
+        memcpy(base+header.mPreferMin, rig.mPreferMin.data(), joints*sizeof(uint8_t));
+    }
+}
+
+FabrikRigFile::FabrikRigFile()
+    : mData(nullptr), mSize(0),
+#ifdef _WIN32
+      mFile(nullptr), mMapping(nullptr),
+#endif
+      mPack()
+{
+}
+
+FabrikRigFile::~FabrikRigFile()
+{
+    Close();
+}
+
+bool FabrikRigFile::Open(const char* path)
+{
+    Close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(mapping == nullptr)
+    {
+        CloseHandle(file);
+        return false;
+    }
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if(data == nullptr)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    mFile = file;
+    mMapping = mapping;
+    mData = data;
+    mSize = size.QuadPart;
+#else
+    int file = open(path, O_RDONLY);
+    if(file < 0)
+    {
+        return false;
+    }
+    struct stat status;
+    if(fstat(file, &status) != 0 || status.st_size == 0)
+    {
+        close(file);
+        return false;
+    }
+    void* data = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    // THE MAPPING KEEPS THE FILE ALIVE
+    close(file);
+    if(data == MAP_FAILED)
+    {
+        return false;
+    }
+    mData = data;
+    mSize = status.st_size;
+#endif
+
+    if(!mPack.Open(mData, mSize))
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void FabrikRigFile::Close()
+{
+    mPack.Close();
+    if(mData == nullptr)
+    {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(mData);
+    CloseHandle(mMapping);
+    CloseHandle(mFile);
+    mFile = nullptr;
+    mMapping = nullptr;
+#else
+    munmap(mData, mSize);
+#endif
+    mData = nullptr;
+    mSize = 0;
+}
+
+const FabrikRigPack& FabrikRigFile::GetPack() const
+{
+    return mPack;
+}
+
+static bool ReadFloat(const rapidjson::Value& object, const char* name, float& value, std::string& error, const std::string& where)
+{
+    rapidjson::Value::ConstMemberIterator member = object.FindMember(name);
+    if(member == object.MemberEnd())
+    {
+        return true;
+    }
+    if(!member->value.IsNumber())
+    {
+        error = where+"."+name+" must be a number";
+        return false;
+    }
+    value = member->value.GetFloat();
+    return true;
+}
+
+bool FabrikRigJson::ReadRig(const rapidjson::Value& object, FabrikPD2D& rig, std::string& error, const std::string& where)
+{
+    if(!object.IsObject())
+    {
+        error = where+" must be an object";
+        return false;
+    }
+
+    rapidjson::Value::ConstMemberIterator base = object.FindMember("base");
+    if(base != object.MemberEnd())
+    {
+        if(!base->value.IsObject())
+        {
+            error = where+".base must be an object";
+            return false;
+        }
+        rapidjson::Value::ConstMemberIterator position = base->value.FindMember("position");
+        if(position != base->value.MemberEnd())
+        {
+            if(!position->value.IsArray() || position->value.Size() != 2 || !position->value[0].IsNumber() || !position->value[1].IsNumber())
+            {
+                error = where+".base.position must be [x, y]";
+                return false;
+            }
+            rig.mBasePosition = FabrikVec2{position->value[0].GetFloat(), position->value[1].GetFloat()};
+        }
+        if(!ReadFloat(base->value, "theta", rig.mBaseTheta, error, where+".base"))
+        {
+            return false;
+        }
+        rig.mBaseRotation = RotationFromDegrees(rig.mBaseTheta);
+    }
+
+    rapidjson::Value::ConstMemberIterator solver = object.FindMember("solver");
+    if(solver != object.MemberEnd())
+    {
+        if(!solver->value.IsObject())
+        {
+            error = where+".solver must be an object";
+            return false;
+        }
+        rapidjson::Value::ConstMemberIterator limit = solver->value.FindMember("iterationLimit");
+        if(limit != solver->value.MemberEnd())
+        {
+            if(!limit->value.IsUint())
+            {
+                error = where+".solver.iterationLimit must be an unsigned integer";
+                return false;
+            }
+            rig.mIterationLimit = limit->value.GetUint();
+        }
+        if(!ReadFloat(solver->value, "iterationThreshold", rig.mIterationThreshold, error, where+".solver")
+            || !ReadFloat(solver->value, "threshold", rig.mThreshold, error, where+".solver")
+            || !ReadFloat(solver->value, "targetEpsilon", rig.mTargetEpsilon, error, where+".solver"))
+        {
+            return false;
+        }
+    }
+
+    rapidjson::Value::ConstMemberIterator bones = object.FindMember("bones");
+    if(bones == object.MemberEnd() || !bones->value.IsArray())
+    {
+        error = where+".bones must be an array";
+        return false;
+    }
+
+    uint32_t joints = bones->value.Size()+1;
+    std::shared_ptr<FabrikPD2D::Definition> definition = std::make_shared<FabrikPD2D::Definition>();
+    definition->mParents.reserve(joints);
+    definition->mChildren.reserve(joints);
+    definition->mSiblings.reserve(joints);
+    definition->mLengths.reserve(joints);
+    definition->mLengthSums.reserve(joints);
+    definition->mLimits.reserve(joints);
+    definition->mRotations.reserve(joints);
+    definition->mPreferMin.reserve(joints);
+
+    // LAST CHILD OF EVERY JOINT, SO LINKING A SIBLING IS O(1)
+    std::vector<uint32_t> lastChildren(joints, 0);
+    for(uint32_t bone = 1; bone < joints; bone++)
+    {
+        const rapidjson::Value& entry = bones->value[bone-1];
+        std::string at = where+".bones["+std::to_string(bone-1)+"]";
+        if(!entry.IsObject())
+        {
+            error = at+" must be an object";
+            return false;
+        }
+
+        uint32_t parent = bone-1;
+        rapidjson::Value::ConstMemberIterator member = entry.FindMember("parent");
+        if(member != entry.MemberEnd())
+        {
+            if(!member->value.IsUint() || member->value.GetUint() >= bone)
+            {
+                error = at+".parent must be 0 or an earlier bone";
+                return false;
+            }
+            parent = member->value.GetUint();
+        }
+
+        member = entry.FindMember("length");
+        if(member == entry.MemberEnd() || !member->value.IsNumber() || member->value.GetFloat() < 0)
+        {
+            error = at+".length must be a number of at least 0";
+            return false;
+        }
+        float length = member->value.GetFloat();
+
+        float theta = 0;
+        float minTheta = -180;
+        float maxTheta = 180;
+        if(!ReadFloat(entry, "theta", theta, error, at) || !ReadFloat(entry, "minTheta", minTheta, error, at)
+            || !ReadFloat(entry, "maxTheta", maxTheta, error, at))
+        {
+            return false;
+        }
+        // AS SetMinTheta, SetMaxTheta AND SetTheta WOULD
+        minTheta = minTheta < -360 ? -360 : (minTheta > 360 ? 360 : minTheta);
+        maxTheta = maxTheta < -360 ? -360 : (maxTheta > 360 ? 360 : maxTheta);
+        theta = theta < minTheta ? minTheta : (theta > maxTheta ? maxTheta : theta);
+
+        FabrikVec2 rotation = RotationFromDegrees(theta);
+        FabrikLimit limit;
+        limit.Set(minTheta, maxTheta);
+
+        definition->mParents.push_back(parent);
+        definition->mChildren.push_back(0);
+        definition->mSiblings.push_back(0);
+        definition->mLengths.push_back(length);
+        definition->mLengthSums.push_back(definition->mLengthSums[parent]+length);
+        definition->mLimits.push_back(limit);
+        definition->mRotations.push_back(rotation);
+        definition->mPreferMin.push_back(limit.PreferMin(rotation));
+
+        if(lastChildren[parent] == 0)
+        {
+            definition->mChildren[parent] = bone;
+        }
+        else
+        {
+            definition->mSiblings[lastChildren[parent]] = bone;
+            definition->mBranched = true;
+        }
+        lastChildren[parent] = bone;
+    }
+
+    rig.mDefinition = definition;
+    rig.mOwnsDefinition = true;
+    rig.ResetPose();
+    return true;
+}
+
+bool FabrikRigJson::Read(const char* text, size_t length, std::vector<FabrikPD2D>& rigs, std::string& error)
+{
+    rapidjson::Document document;
+    document.Parse(text, length);
+    if(document.HasParseError())
+    {
+        error = std::string("offset ")+std::to_string(document.GetErrorOffset())+": "+rapidjson::GetParseError_En(document.GetParseError());
+        return false;
+    }
+
+    if(!document.IsObject() || !document.HasMember("rigs") || !document["rigs"].IsArray())
+    {
+        error = "rigs must be an array";
+        return false;
+    }
+
+    const rapidjson::Value& list = document["rigs"];
+    std::vector<FabrikPD2D> read(list.Size());
+    for(uint32_t r = 0; r < list.Size(); r++)
+    {
+        if(!ReadRig(list[r], read[r], error, "rigs["+std::to_string(r)+"]"))
+        {
+            return false;
+        }
+    }
+
+    rigs.reserve(rigs.size()+read.size());
+    for(FabrikPD2D& rig : read)
+    {
+        rigs.push_back(std::move(rig));
+    }
+    return true;
+}
+
+// THE SHORTEST DECIMAL THAT READS BACK AS THE SAME float, 0.1f IS WRITTEN
+// AS 0.1 AND NOT AS THE double IT WIDENS TO
+static void WriteFloat(rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer, float value)
+{
+    char buffer[32];
+    for(int precision = 1; precision <= 9; precision++)
+    {
+        snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+        if(strtof(buffer, nullptr) == value)
+        {
+            break;
+        }
+    }
+    writer.Double(strtod(buffer, nullptr));
+}
+
+void FabrikRigJson::Write(const std::vector<FabrikPD2D>& rigs, std::string& text)
+{
+    rapidjson::StringBuffer buffer;
+    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+    writer.SetIndent(' ', 4);
+
+    writer.StartObject();
+    writer.Key("rigs");
+    writer.StartArray();
+    for(const FabrikPD2D& written : rigs)
+    {
+        // AS FabrikRigPack::Write
+        std::unique_ptr<FabrikPD2D> followed;
+        if(written.mTailBone != 0 || written.mStaleBone != 0)
+        {
+            followed.reset(new FabrikPD2D(written));
+            followed->UpdateRotations();
+        }
+        const FabrikPD2D& rig = followed ? *followed : written;
+
+        writer.StartObject();
+
+        writer.Key("base");
+        writer.StartObject();
+        writer.Key("position");
+        writer.SetFormatOptions(rapidjson::kFormatSingleLineArray);
+        writer.StartArray();
+        WriteFloat(writer, rig.mBasePosition.x);
+        WriteFloat(writer, rig.mBasePosition.y);
+        writer.EndArray();
+        writer.SetFormatOptions(rapidjson::kFormatDefault);
+        writer.Key("theta");
+        WriteFloat(writer, rig.mBaseTheta);
+        writer.EndObject();
+
+        writer.Key("solver");
+        writer.StartObject();
+        writer.Key("iterationLimit");
+        writer.Uint(rig.mIterationLimit);
+        writer.Key("iterationThreshold");
+        WriteFloat(writer, rig.mIterationThreshold);
+        writer.Key("threshold");
+        WriteFloat(writer, rig.mThreshold);
+        writer.Key("targetEpsilon");
+        WriteFloat(writer, rig.mTargetEpsilon);
+        writer.EndObject();
+
+        writer.Key("bones");
+        writer.StartArray();
+        const FabrikPD2D::Definition& definition = *rig.mDefinition;
+        for(uint32_t bone = 1; bone < rig.mRotations.size(); bone++)
+        {
+            writer.StartObject();
+            // THE DEFAULTS ARE LEFT OUT TO KEEP LONG CHAINS READABLE
+            if(definition.mParents[bone] != bone-1)
+            {
+                writer.Key("parent");
+                writer.Uint(definition.mParents[bone]);
+            }
+            writer.Key("length");
+            WriteFloat(writer, definition.mLengths[bone]);
+            // IN THE DEGREES OF THE LIMIT, WHICH Read CLAMPS TO
+            const FabrikLimit& limit = definition.mLimits[bone];
+            writer.Key("theta");
+            WriteFloat(writer, limit.Unwrap(DegreesFromRotation(rig.mRotations[bone])));
+            if(limit.GetMinTheta() != -180 || limit.GetMaxTheta() != 180)
+            {
+                writer.Key("minTheta");
+                WriteFloat(writer, limit.GetMinTheta());
+                writer.Key("maxTheta");
+                WriteFloat(writer, limit.GetMaxTheta());
+            }
+            writer.EndObject();
+        }
+        writer.EndArray();
+
+        writer.EndObject();
+    }
+    writer.EndArray();
+    writer.EndObject();
+
+    text.assign(buffer.GetString(), buffer.GetSize());
+    text += '\n';
+}
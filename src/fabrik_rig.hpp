@@ -0,0 +1,133 @@
+#ifndef FABRIKPD2D_RIG_HPP
+#define FABRIKPD2D_RIG_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <rapidjson/fwd.h>
+
+#include "fabrik.hpp"
+
+// RIG FILES. JSON IS THE AUTHORING FORMAT, A PACK IS WHAT A LEVEL SHIPS: THE
+// BONE ARRAYS OF EVERY RIG IN THE SOLVER'S OWN LAYOUT, READY TO BE MAPPED AND
+// COPIED IN BULK WITHOUT PARSING. PACKS ARE NATIVE, THEY ARE REJECTED ON A
+// MACHINE WITH ANOTHER BYTE ORDER OR FabrikLimit LAYOUT AND NEED COMPILING
+// AGAIN FROM THE JSON THERE.
+
+class FabrikRigHeader;
+
+// ONE RIG INSIDE AN OPEN PACK, VALID AS LONG AS THE PACK'S BYTES
+class FabrikRigImage
+{
+    public:
+
+    FabrikRigImage();
+
+    uint32_t GetBoneCount() const;
+
+    // THE BONES ALONE, TO BE SHARED BY MANY INSTANCES. nullptr WHEN THE
+    // TOPOLOGY IS INCONSISTENT: LINKS OUT OF ORDER, A BRANCHED FLAG THAT
+    // DOES NOT MATCH THE SIBLINGS, OR LENGTH SUMS THAT DO NOT ADD UP.
+    std::shared_ptr<const FabrikPD2D::Definition> LoadDefinition() const;
+
+    // REPLACES THE BONES AND SETTINGS OF rig, ONE COPY PER ARRAY. RETURNS
+    // false AND LEAVES rig AS IT WAS WHEN THE TOPOLOGY IS INCONSISTENT.
+    bool Load(FabrikPD2D& rig) const;
+
+    private:
+
+    const FabrikRigHeader* mHeader;
+
+    friend class FabrikRigPack;
+};
+
+class FabrikRigPack
+{
+    public:
+
+    FabrikRigPack();
+
+    // CHECKS THE HEADERS AND THE BOUNDS OF EVERY ARRAY. data IS NOT COPIED,
+    // IT MUST OUTLIVE THE PACK AND BE 16 BYTE ALIGNED.
+    bool Open(const void* data, size_t size);
+    void Close();
+    bool IsOpen() const;
+
+    uint32_t GetRigCount() const;
+    FabrikRigImage GetRig(uint32_t rig) const;
+
+    // COMPILES rigs INTO A PACK
+    static void Write(const std::vector<FabrikPD2D>& rigs, std::vector<uint8_t>& pack);
+
+    private:
+
+    const uint8_t* mData;
+    size_t mSize;
+    uint32_t mCount;
+};
+
+// A PACK FILE MAPPED READ ONLY, PAGES ARE READ IN AS RIGS ARE LOADED
+class FabrikRigFile
+{
+    public:
+
+    FabrikRigFile();
+    ~FabrikRigFile();
+
+    FabrikRigFile(const FabrikRigFile&) = delete;
+    FabrikRigFile& operator=(const FabrikRigFile&) = delete;
+
+    bool Open(const char* path);
+    void Close();
+
+    const FabrikRigPack& GetPack() const;
+
+    private:
+
+    void* mData;
+    size_t mSize;
+#ifdef _WIN32
+    void* mFile;
+    void* mMapping;
+#endif
+    FabrikRigPack mPack;
+};
+
+// THE AUTHORING FORMAT:
+//
+// {
+//     "rigs": [
+//         {
+//             "base": {"position": [0, 0], "theta": 90},
+//             "solver": {"iterationLimit": 20, "iterationThreshold": 0.1, "threshold": 1, "targetEpsilon": 0},
+//             "bones": [
+//                 {"length": 90},
+//                 {"length": 90, "theta": 15, "minTheta": -45, "maxTheta": 45},
+//                 {"parent": 1, "length": 20, "theta": -30}
+//             ]
+//         }
+//     ]
+// }
+//
+// BONE i OF THE LIST IS BONE i+1 OF THE RIG. parent DEFAULTS TO THE BONE
+// BEFORE, 0 IS THE BASE, AND MUST COME EARLIER IN THE LIST. ANGLES ARE IN
+// DEGREES RELATIVE TO THE PARENT. base AND solver ARE OPTIONAL AND DEFAULT
+// TO A NEW FabrikPD2D's SETTINGS.
+class FabrikRigJson
+{
+    public:
+
+    // APPENDS THE RIGS OF text TO rigs. ON FAILURE rigs IS UNCHANGED AND
+    // error SAYS WHERE.
+    static bool Read(const char* text, size_t length, std::vector<FabrikPD2D>& rigs, std::string& error);
+    static void Write(const std::vector<FabrikPD2D>& rigs, std::string& text);
+
+    private:
+
+    static bool ReadRig(const rapidjson::Value& object, FabrikPD2D& rig, std::string& error, const std::string& where);
+};
+
+#endif
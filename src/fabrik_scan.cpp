@@ -0,0 +1,276 @@
+#include "fabrik_scan.hpp"
+#include "fabrik_limit.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FABRIKPD2D_SCAN_SSE2
+#endif
+
+namespace
+{
+    // THE STEP OF FabrikPD2D::UpdateCache, FIRST ORDER RENORMALIZATION INCLUDED
+    inline FabrikVec2 Renormalize(FabrikVec2 rotation)
+    {
+        return rotation*(1.5f-0.5f*FabrikFloat::LengthSqr(rotation));
+    }
+}
+
+FabrikScan::FabrikScan()
+    : mBlock(4096), mRunMutex(), mRotations(nullptr), mLengths(nullptr), mRotationsGlobal(nullptr), mJoints(nullptr),
+      mFirst(0), mCount(0), mBlocks(0), mPhase(PHASE_SCAN), mNext(0),
+      mBlockRotations(), mBlockJoints(), mCarryRotations(), mCarryJoints(),
+      mThreadCount(1), mThreads(), mStateMutex(), mStart(), mDone(), mGeneration(0), mBusy(0), mQuit(false)
+{
+    StartThreads();
+}
+
+FabrikScan::~FabrikScan()
+{
+    StopThreads();
+}
+
+void FabrikScan::SetThreads(uint32_t threads)
+{
+    if(threads == 0)
+    {
+        threads = std::thread::hardware_concurrency();
+        if(threads == 0)
+        {
+            threads = 1;
+        }
+    }
+    if(threads == mThreadCount)
+    {
+        return;
+    }
+
+    StopThreads();
+    mThreadCount = threads;
+    StartThreads();
+}
+
+uint32_t FabrikScan::GetThreads()
+{
+    return mThreadCount;
+}
+
+void FabrikScan::SetBlock(uint32_t bones)
+{
+    mBlock = bones > 0 ? bones : 1;
+}
+
+uint32_t FabrikScan::GetBlock()
+{
+    return mBlock;
+}
+
+void FabrikScan::StartThreads()
+{
+    mQuit = false;
+    // THE CALLER OF Run IS THE FIRST THREAD
+    for(uint32_t i = 1; i < mThreadCount; i++)
+    {
+        mThreads.emplace_back(&FabrikScan::ThreadMain, this);
+    }
+}
+
+void FabrikScan::StopThreads()
+{
+    {
+        std::lock_guard<std::mutex> lock(mStateMutex);
+        mQuit = true;
+    }
+    mStart.notify_all();
+    for(std::thread& thread : mThreads)
+    {
+        thread.join();
+    }
+    mThreads.clear();
+}
+
+void FabrikScan::ThreadMain()
+{
+    uint64_t generation = 0;
+    while(true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mStateMutex);
+            mStart.wait(lock, [&]{ return mQuit || mGeneration != generation; });
+            if(mQuit)
+            {
+                return;
+            }
+            generation = mGeneration;
+        }
+
+        Work();
+
+        {
+            std::lock_guard<std::mutex> lock(mStateMutex);
+            --mBusy;
+        }
+        mDone.notify_all();
+    }
+}
+
+void FabrikScan::Run(const FabrikVec2* rotations, const float* lengths, FabrikVec2* rotationsGlobal, FabrikVec2* joints,
+    uint32_t first, uint32_t count)
+{
+    if(first >= count)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mRunMutex);
+    mRotations = rotations;
+    mLengths = lengths;
+    mRotationsGlobal = rotationsGlobal;
+    mJoints = joints;
+    mFirst = first;
+    mCount = count;
+
+    // ONE THREAD OR ONE BLOCK: THE FIRST BLOCK IS THE SERIAL SWEEP
+    uint32_t blocks = (count-first+mBlock-1)/mBlock;
+    if(mThreadCount == 1 || blocks < 2)
+    {
+        mBlocks = 1;
+        ScanBlock(0);
+        return;
+    }
+    mBlocks = blocks;
+    mBlockRotations.resize(blocks);
+    mBlockJoints.resize(blocks);
+    mCarryRotations.resize(blocks);
+    mCarryJoints.resize(blocks);
+
+    RunPhase(PHASE_SCAN);
+
+    // THE FIRST BLOCK IS ALREADY IN PLACE, EACH CARRY IS THE ONE BEFORE
+    // FOLLOWED BY WHAT THAT BLOCK ADDS
+    mCarryRotations[1] = mBlockRotations[0];
+    mCarryJoints[1] = mBlockJoints[0];
+    for(uint32_t block = 1; block+1 < blocks; block++)
+    {
+        FabrikVec2 rotation = mCarryRotations[block];
+        mCarryJoints[block+1] = mCarryJoints[block]+RotateBy(rotation, mBlockJoints[block]);
+        mCarryRotations[block+1] = Renormalize(RotateBy(rotation, mBlockRotations[block]));
+    }
+
+    RunPhase(PHASE_CARRY);
+}
+
+void FabrikScan::RunPhase(Phase phase)
+{
+    mPhase = phase;
+    mNext.store(0);
+    {
+        std::lock_guard<std::mutex> lock(mStateMutex);
+        mBusy = mThreads.size();
+        ++mGeneration;
+    }
+    mStart.notify_all();
+
+    Work();
+
+    // EVERY THREAD CHECKS OUT BEFORE THE NEXT PHASE READS ITS BLOCKS
+    std::unique_lock<std::mutex> lock(mStateMutex);
+    mDone.wait(lock, [&]{ return mBusy == 0; });
+}
+
+void FabrikScan::Work()
+{
+    uint32_t block;
+    while((block = mNext.fetch_add(1)) < mBlocks)
+    {
+        if(mPhase == PHASE_SCAN)
+        {
+            ScanBlock(block);
+        }
+        else
+        {
+            CarryBlock(block);
+        }
+    }
+}
+
+void FabrikScan::ScanBlock(uint32_t block)
+{
+    // THE LAST BLOCK TAKES WHAT IS LEFT
+    uint32_t begin = mFirst+block*mBlock;
+    uint32_t end = block+1 < mBlocks ? begin+mBlock : mCount;
+
+    // THE FIRST BLOCK STARTS FROM THE PARENT AND IS FINAL, THE OTHERS FROM
+    // THE IDENTITY AND GET CARRIED
+    FabrikVec2 rotationGlobal = FabrikVec2{1, 0};
+    FabrikVec2 joint = FabrikVec2{0, 0};
+    if(block == 0)
+    {
+        rotationGlobal = mRotationsGlobal[begin-1];
+        joint = mJoints[begin-1];
+    }
+    for(uint32_t i = begin; i < end; i++)
+    {
+        rotationGlobal = Renormalize(RotateBy(rotationGlobal, mRotations[i]));
+        joint = joint+rotationGlobal*mLengths[i];
+        mRotationsGlobal[i] = rotationGlobal;
+        mJoints[i] = joint;
+    }
+
+    if(mBlocks > 1)
+    {
+        mBlockRotations[block] = rotationGlobal;
+        mBlockJoints[block] = joint;
+    }
+}
+
+void FabrikScan::CarryBlock(uint32_t block)
+{
+    if(block == 0)
+    {
+        return;
+    }
+
+    uint32_t begin = mFirst+block*mBlock;
+    uint32_t end = block+1 < mBlocks ? begin+mBlock : mCount;
+    FabrikVec2 rotation = mCarryRotations[block];
+    FabrikVec2 carry = mCarryJoints[block];
+
+    uint32_t i = begin;
+#ifdef FABRIKPD2D_SCAN_SSE2
+    // TWO BONES PER REGISTER AS (x0, y0, x1, y1). (c.x*l.x - c.y*l.y, c.x*l.y + c.y*l.x)
+    // IS c.x*l + (-c.y, c.y)*SWAP(l), THE SAME OPERATIONS AS RotateBy.
+    const __m128 cx = _mm_set1_ps(rotation.x);
+    const __m128 cy = _mm_set_ps(rotation.y, -rotation.y, rotation.y, -rotation.y);
+    const __m128 joints = _mm_set_ps(carry.y, carry.x, carry.y, carry.x);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 threeHalves = _mm_set1_ps(1.5f);
+    for(; i+2 <= end; i += 2)
+    {
+        float* global = &mRotationsGlobal[i].x;
+        float* joint = &mJoints[i].x;
+
+        __m128 l = _mm_loadu_ps(global);
+        __m128 r = _mm_add_ps(_mm_mul_ps(cx, l), _mm_mul_ps(cy, _mm_shuffle_ps(l, l, _MM_SHUFFLE(2, 3, 0, 1))));
+        __m128 squares = _mm_mul_ps(r, r);
+        __m128 lengthSqr = _mm_add_ps(squares, _mm_shuffle_ps(squares, squares, _MM_SHUFFLE(2, 3, 0, 1)));
+        r = _mm_mul_ps(r, _mm_sub_ps(threeHalves, _mm_mul_ps(half, lengthSqr)));
+        _mm_storeu_ps(global, r);
+
+        __m128 q = _mm_loadu_ps(joint);
+        q = _mm_add_ps(_mm_mul_ps(cx, q), _mm_mul_ps(cy, _mm_shuffle_ps(q, q, _MM_SHUFFLE(2, 3, 0, 1))));
+        _mm_storeu_ps(joint, _mm_add_ps(joints, q));
+    }
+#endif
+    for(; i < end; i++)
+    {
+        mRotationsGlobal[i] = Renormalize(RotateBy(rotation, mRotationsGlobal[i]));
+        mJoints[i] = carry+RotateBy(rotation, mJoints[i]);
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef FABRIKPD2D_SCAN_HPP
+#define FABRIKPD2D_SCAN_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "fabrik_vector.hpp"
+
+// FORWARD KINEMATICS OF A LONG LINEAR CHAIN AS A PREFIX SCAN. GLOBAL
+// ROTATIONS ARE A RUNNING PRODUCT AND JOINTS A RUNNING SUM, SO THE CHAIN IS
+// CUT INTO BLOCKS THAT ARE SCANNED ON THEIR OWN IN PARALLEL, THEN EACH BLOCK
+// IS CARRIED INTO THE FRAME OF THE ONES BEFORE IT (SSE2, TWO BONES A
+// REGISTER). THE BLOCKS DO NOT DEPEND ON THE THREAD COUNT, SO NEITHER DO THE
+// RESULTS. THEY MATCH THE SERIAL SWEEP TO A FEW ULPS PER BLOCK, AND EXACTLY
+// WITH ONE THREAD, WHICH RUNS THE SERIAL SWEEP.
+//
+// HAND IT TO A RIG WITH FabrikPD2D::SetScan. ONE Run AT A TIME: THE CALL IN
+// PROGRESS AND THE BLOCKS ARE MEMBERS, SO RIGS SHARING A SCAN AND UPDATED
+// FROM DIFFERENT THREADS, AS IN FabrikWorld, TAKE TURNS ON IT. GIVE THEM ONE
+// EACH TO RUN THEM TOGETHER.
+class FabrikScan
+{
+    public:
+
+    FabrikScan();
+    ~FabrikScan();
+
+    FabrikScan(const FabrikScan&) = delete;
+    FabrikScan& operator=(const FabrikScan&) = delete;
+
+    // THREADS INCLUDING THE CALLER OF Run, 0 PICKS THE HARDWARE CONCURRENCY
+    void SetThreads(uint32_t threads);
+    uint32_t GetThreads();
+
+    // BONES PER BLOCK, THE UNIT OF WORK OF A THREAD. SHORTER SUFFIXES THAN
+    // TWO BLOCKS ARE SWEPT SERIALLY.
+    void SetBlock(uint32_t bones);
+    uint32_t GetBlock();
+
+    // FILLS rotationsGlobal AND joints FOR BONES [first, count) FROM THEIR
+    // LOCAL rotations AND lengths, THE PARENT OF BONE i BEING i-1. ENTRY
+    // first-1 OF BOTH MUST BE UP TO DATE.
+    void Run(const FabrikVec2* rotations, const float* lengths, FabrikVec2* rotationsGlobal, FabrikVec2* joints,
+        uint32_t first, uint32_t count);
+
+    private:
+
+    enum Phase
+    {
+        PHASE_SCAN, // EACH BLOCK FROM THE IDENTITY AT ITS START
+        PHASE_CARRY // EACH BLOCK INTO THE FRAME AT ITS START
+    };
+
+    void StartThreads();
+    void StopThreads();
+    void ThreadMain();
+
+    // HANDS OUT BLOCKS TO ALL THREADS UNTIL NONE ARE LEFT
+    void RunPhase(Phase phase);
+    void Work();
+    void ScanBlock(uint32_t block);
+    void CarryBlock(uint32_t block);
+
+    uint32_t mBlock;
+
+    // THE CALL IN PROGRESS, HELD BY ITS CALLER FOR ALL OF Run
+    std::mutex mRunMutex;
+    const FabrikVec2* mRotations;
+    const float* mLengths;
+    FabrikVec2* mRotationsGlobal;
+    FabrikVec2* mJoints;
+    uint32_t mFirst;
+    uint32_t mCount;
+    uint32_t mBlocks;
+    Phase mPhase;
+    std::atomic<uint32_t> mNext;
+
+    // PER BLOCK: WHAT IT ADDS ON ITS OWN, THEN THE FRAME AT ITS START
+    std::vector<FabrikVec2> mBlockRotations;
+    std::vector<FabrikVec2> mBlockJoints;
+    std::vector<FabrikVec2> mCarryRotations;
+    std::vector<FabrikVec2> mCarryJoints;
+
+    uint32_t mThreadCount;
+    std::vector<std::thread> mThreads;
+
+    std::mutex mStateMutex;
+    std::condition_variable mStart;
+    std::condition_variable mDone;
+    uint64_t mGeneration;
+    uint32_t mBusy;
+    bool mQuit;
+};
+
+#endif
@@ -0,0 +1,190 @@
+#include "fabrik_stats.hpp"
+#include "fabrik.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+FabrikStatsHistogram::FabrikStatsHistogram()
+{
+    Clear();
+}
+
+void FabrikStatsHistogram::Add(const FabrikPD2D::SolveStats& stats)
+{
+    ++mCalls;
+    ++mClamps[LogBin(stats.mClamps)];
+    ++mNanoseconds[LogBin(stats.mNanoseconds)];
+
+    for(const FabrikPD2D::SolveStats::Effector& effector : stats.mEffectors)
+    {
+        ++mEffectors;
+        ++mTerminations[effector.mTermination];
+        if(effector.mTermination == FabrikReachStats::TERMINATION_NONE || effector.mTermination == FabrikReachStats::TERMINATION_SKIPPED)
+        {
+            continue;
+        }
+
+        ++mSolved;
+        ++mIterations[effector.mIterations < ITERATION_BINS ? effector.mIterations : ITERATION_BINS-1];
+        ++mErrors[LogBin((uint64_t)ldexpf(effector.mError, ERROR_SHIFT))];
+    }
+}
+
+void FabrikStatsHistogram::Clear()
+{
+    mCalls = 0;
+    mEffectors = 0;
+    mSolved = 0;
+    for(uint64_t& count : mIterations)
+    {
+        count = 0;
+    }
+    for(uint64_t& count : mTerminations)
+    {
+        count = 0;
+    }
+    for(uint32_t bin = 0; bin < LOG_BINS; bin++)
+    {
+        mErrors[bin] = 0;
+        mClamps[bin] = 0;
+        mNanoseconds[bin] = 0;
+    }
+}
+
+uint64_t FabrikStatsHistogram::GetCallCount() const
+{
+    return mCalls;
+}
+
+uint64_t FabrikStatsHistogram::GetEffectorCount() const
+{
+    return mEffectors;
+}
+
+uint64_t FabrikStatsHistogram::GetIterations(uint32_t bin) const
+{
+    if(bin >= ITERATION_BINS)
+    {
+        return 0;
+    }
+    return mIterations[bin];
+}
+
+uint64_t FabrikStatsHistogram::GetTermination(FabrikReachStats::Termination termination) const
+{
+    if(termination >= FabrikReachStats::TERMINATION_COUNT)
+    {
+        return 0;
+    }
+    return mTerminations[termination];
+}
+
+uint64_t FabrikStatsHistogram::GetErrors(uint32_t bin) const
+{
+    if(bin >= LOG_BINS)
+    {
+        return 0;
+    }
+    return mErrors[bin];
+}
+
+uint64_t FabrikStatsHistogram::GetClamps(uint32_t bin) const
+{
+    if(bin >= LOG_BINS)
+    {
+        return 0;
+    }
+    return mClamps[bin];
+}
+
+uint64_t FabrikStatsHistogram::GetNanoseconds(uint32_t bin) const
+{
+    if(bin >= LOG_BINS)
+    {
+        return 0;
+    }
+    return mNanoseconds[bin];
+}
+
+uint32_t FabrikStatsHistogram::GetIterationPercentile(float fraction) const
+{
+    uint64_t count = 0;
+    for(uint32_t bin = 0; bin < ITERATION_BINS; bin++)
+    {
+        count += mIterations[bin];
+        if(count >= fraction*mSolved)
+        {
+            return bin;
+        }
+    }
+    return ITERATION_BINS-1;
+}
+
+uint64_t FabrikStatsHistogram::GetNanosecondPercentile(float fraction) const
+{
+    uint64_t count = 0;
+    for(uint32_t bin = 0; bin < LOG_BINS; bin++)
+    {
+        count += mNanoseconds[bin];
+        if(count >= fraction*mCalls)
+        {
+            return bin > 0 ? (uint64_t)1 << (bin-1) : 0;
+        }
+    }
+    return (uint64_t)1 << (LOG_BINS-2);
+}
+
+void FabrikStatsHistogram::Print(FILE* file) const
+{
+    static const char* names[FabrikReachStats::TERMINATION_COUNT] = {"none", "skipped", "converged", "stalled", "iteration limit", "closed form"};
+
+    fprintf(file, "calls %llu, effectors %llu, solved %llu\n", (unsigned long long)mCalls, (unsigned long long)mEffectors, (unsigned long long)mSolved);
+    for(uint32_t termination = 0; termination < FabrikReachStats::TERMINATION_COUNT; termination++)
+    {
+        fprintf(file, "  %-16s %llu\n", names[termination], (unsigned long long)mTerminations[termination]);
+    }
+    fprintf(file, "iterations p50 %u, p90 %u, p99 %u\n", GetIterationPercentile(0.5f), GetIterationPercentile(0.9f), GetIterationPercentile(0.99f));
+    for(uint32_t bin = 0; bin < ITERATION_BINS; bin++)
+    {
+        if(mIterations[bin] != 0)
+        {
+            fprintf(file, "  %s%-3u %llu\n", bin == ITERATION_BINS-1 ? ">=" : "", bin, (unsigned long long)mIterations[bin]);
+        }
+    }
+    fprintf(file, "error\n");
+    for(uint32_t bin = 0; bin < LOG_BINS; bin++)
+    {
+        if(mErrors[bin] != 0)
+        {
+            fprintf(file, "  < %-12g %llu\n", ldexpf(1, (int)bin-ERROR_SHIFT), (unsigned long long)mErrors[bin]);
+        }
+    }
+    fprintf(file, "clamps per call\n");
+    for(uint32_t bin = 0; bin < LOG_BINS; bin++)
+    {
+        if(mClamps[bin] != 0)
+        {
+            fprintf(file, "  < %-12llu %llu\n", (unsigned long long)1 << bin, (unsigned long long)mClamps[bin]);
+        }
+    }
+    fprintf(file, "ns per call, p50 >= %llu, p99 >= %llu\n", (unsigned long long)GetNanosecondPercentile(0.5f), (unsigned long long)GetNanosecondPercentile(0.99f));
+    for(uint32_t bin = 0; bin < LOG_BINS; bin++)
+    {
+        if(mNanoseconds[bin] != 0)
+        {
+            fprintf(file, "  < %-12llu %llu\n", (unsigned long long)1 << bin, (unsigned long long)mNanoseconds[bin]);
+        }
+    }
+}
+
+uint32_t FabrikStatsHistogram::LogBin(uint64_t value)
+{
+    uint32_t bin = 0;
+    while(value != 0 && bin < LOG_BINS-1)
+    {
+        value >>= 1;
+        ++bin;
+    }
+    return bin;
+}
@@ -0,0 +1,61 @@
+#ifndef FABRIKPD2D_STATS_HPP
+#define FABRIKPD2D_STATS_HPP
+
+#include <cstdint>
+#include <cstdio>
+
+#include "fabrik.hpp"
+
+// HISTOGRAMS OVER MANY FabrikPD2D::SolveStats, TO TUNE THE ITERATION LIMIT AND
+// THRESHOLDS OR SPOT RIGS THAT BURN THE WHOLE BUDGET EVERY FRAME. ADD ONE
+// SolveStats PER CALL, FROM ANY NUMBER OF RIGS.
+class FabrikStatsHistogram
+{
+    public:
+
+    static constexpr uint32_t ITERATION_BINS = 65; // THE LAST BIN COUNTS 64 AND MORE
+    // POWERS OF TWO: BIN 0 COUNTS VALUES UNDER 1, BIN b VALUES IN [2^(b-1), 2^b)
+    static constexpr uint32_t LOG_BINS = 40;
+    // ERRORS ARE SCALED BY 2^ERROR_SHIFT FIRST SO SUB-UNIT ERRORS SPREAD OUT
+    static constexpr int ERROR_SHIFT = 10;
+
+    FabrikStatsHistogram();
+
+    void Add(const FabrikPD2D::SolveStats& stats);
+    void Clear();
+
+    uint64_t GetCallCount() const;
+    uint64_t GetEffectorCount() const;
+
+    // BY EFFECTOR, SKIPPED AND UNSOLVED EFFECTORS ONLY COUNT IN GetTermination
+    uint64_t GetIterations(uint32_t bin) const;
+    uint64_t GetTermination(FabrikReachStats::Termination termination) const;
+    uint64_t GetErrors(uint32_t bin) const;
+
+    // BY CALL
+    uint64_t GetClamps(uint32_t bin) const;
+    uint64_t GetNanoseconds(uint32_t bin) const;
+
+    // SMALLEST ITERATION COUNT THAT fraction OF THE SOLVED EFFECTORS STAYED AT OR UNDER
+    uint32_t GetIterationPercentile(float fraction) const;
+    // LOWER EDGE OF THE NANOSECOND BIN THAT fraction OF THE CALLS STAYED UNDER
+    uint64_t GetNanosecondPercentile(float fraction) const;
+
+    void Print(FILE* file) const;
+
+    private:
+
+    static uint32_t LogBin(uint64_t value);
+
+    uint64_t mCalls;
+    uint64_t mEffectors;
+    uint64_t mSolved;
+
+    uint64_t mIterations[ITERATION_BINS];
+    uint64_t mTerminations[FabrikReachStats::TERMINATION_COUNT];
+    uint64_t mErrors[LOG_BINS];
+    uint64_t mClamps[LOG_BINS];
+    uint64_t mNanoseconds[LOG_BINS];
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef FABRIKPD2D_VECTOR_HPP
+#define FABRIKPD2D_VECTOR_HPP
+
+// PLAIN 2D VECTOR OF THE SOLVER CORE, NO GRAPHICS LIBRARY NEEDED. SAME
+// LAYOUT AS raylib's Vector2 AND glm::vec2, SEE fabrik_raylib.hpp AND
+// fabrik_glm.hpp FOR THE ADAPTERS.
+template<class S>
+class FabrikVector2
+{
+    public:
+
+    S x;
+    S y;
+};
+
+typedef FabrikVector2<float> FabrikVec2;
+
+template<class S>
+FabrikVector2<S> operator+(FabrikVector2<S> a, FabrikVector2<S> b)
+{
+    return FabrikVector2<S>{a.x+b.x, a.y+b.y};
+}
+
+template<class S>
+FabrikVector2<S> operator-(FabrikVector2<S> a, FabrikVector2<S> b)
+{
+    return FabrikVector2<S>{a.x-b.x, a.y-b.y};
+}
+
+template<class S>
+FabrikVector2<S>& operator+=(FabrikVector2<S>& a, FabrikVector2<S> b)
+{
+    a.x += b.x;
+    a.y += b.y;
+    return a;
+}
+
+template<class S>
+FabrikVector2<S>& operator-=(FabrikVector2<S>& a, FabrikVector2<S> b)
+{
+    a.x -= b.x;
+    a.y -= b.y;
+    return a;
+}
+
+template<class S>
+FabrikVector2<S> operator*(FabrikVector2<S> v, S s)
+{
+    return FabrikVector2<S>{v.x*s, v.y*s};
+}
+
+template<class S>
+FabrikVector2<S> operator/(FabrikVector2<S> v, S s)
+{
+    return FabrikVector2<S>{v.x/s, v.y/s};
+}
+
+// float DIVIDES BY MULTIPLYING WITH THE RECIPROCAL, AS raymath DOES, SO THE
+// RESULTS MATCH THE raylib BACKEND TO THE BIT
+inline FabrikVec2 operator/(FabrikVec2 v, float s)
+{
+    float inverse = 1.0f/s;
+    return FabrikVec2{v.x*inverse, v.y*inverse};
+}
+
+#endif
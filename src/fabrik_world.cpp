@@ -0,0 +1,260 @@
+#include "fabrik_world.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+FabrikWorld::Worker::Worker()
+    : mMutex(), mTasks(), mHead(0), mTail(0)
+{
+}
+
+FabrikWorld::FabrikWorld()
+    : mSlots(), mGrain(2048), mTasks(), mThreadCount(1), mThreads(), mWorkers(),
+      mStateMutex(), mStart(), mDone(), mGeneration(0), mBusy(0), mQuit(false), mPending(0)
+{
+    StartThreads();
+}
+
+FabrikWorld::~FabrikWorld()
+{
+    StopThreads();
+}
+
+uint32_t FabrikWorld::AddChain()
+{
+    mSlots.emplace_back();
+    return mSlots.size()-1;
+}
+
+uint32_t FabrikWorld::GetChainCount()
+{
+    return mSlots.size();
+}
+
+FabrikPD2D& FabrikWorld::GetChain(uint32_t chain)
+{
+    return mSlots[chain].mChain;
+}
+
+FabrikPD2D::EffectorSet& FabrikWorld::GetEffectors(uint32_t chain)
+{
+    return mSlots[chain].mEffectors;
+}
+
+void FabrikWorld::SetThreads(uint32_t threads)
+{
+    if(threads == 0)
+    {
+        threads = std::thread::hardware_concurrency();
+        if(threads == 0)
+        {
+            threads = 1;
+        }
+    }
+    if(threads == mThreadCount)
+    {
+        return;
+    }
+
+    StopThreads();
+    mThreadCount = threads;
+    StartThreads();
+}
+
+uint32_t FabrikWorld::GetThreads()
+{
+    return mThreadCount;
+}
+
+void FabrikWorld::SetGrain(uint32_t grain)
+{
+    mGrain = grain > 0 ? grain : 1;
+}
+
+uint32_t FabrikWorld::GetGrain()
+{
+    return mGrain;
+}
+
+void FabrikWorld::StartThreads()
+{
+    mQuit = false;
+    mWorkers.clear();
+    for(uint32_t i = 0; i < mThreadCount; i++)
+    {
+        mWorkers.push_back(std::unique_ptr<Worker>(new Worker()));
+    }
+    // WORKER 0 IS THE THREAD CALLING Solve
+    for(uint32_t i = 1; i < mThreadCount; i++)
+    {
+        mThreads.emplace_back(&FabrikWorld::ThreadMain, this, i);
+    }
+}
+
+void FabrikWorld::StopThreads()
+{
+    {
+        std::lock_guard<std::mutex> lock(mStateMutex);
+        mQuit = true;
+    }
+    mStart.notify_all();
+    for(std::thread& thread : mThreads)
+    {
+        thread.join();
+    }
+    mThreads.clear();
+}
+
+void FabrikWorld::ThreadMain(uint32_t worker)
+{
+    uint64_t generation = 0;
+    while(true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mStateMutex);
+            mStart.wait(lock, [&]{ return mQuit || (mGeneration != generation && mPending.load() > 0); });
+            if(mQuit)
+            {
+                return;
+            }
+            generation = mGeneration;
+            ++mBusy;
+        }
+
+        RunWorker(worker);
+
+        {
+            std::lock_guard<std::mutex> lock(mStateMutex);
+            --mBusy;
+        }
+        mDone.notify_all();
+    }
+}
+
+void FabrikWorld::Solve()
+{
+    if(mSlots.size() == 0)
+    {
+        return;
+    }
+
+    BuildTasks();
+
+    if(mThreadCount == 1)
+    {
+        RunWorker(0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mStateMutex);
+        ++mGeneration;
+    }
+    mStart.notify_all();
+
+    RunWorker(0);
+
+    // LATE WORKERS MUST LEAVE THE QUEUES BEFORE THE NEXT FRAME REBUILDS THEM
+    std::unique_lock<std::mutex> lock(mStateMutex);
+    mDone.wait(lock, [&]{ return mPending.load() == 0 && mBusy == 0; });
+}
+
+void FabrikWorld::BuildTasks()
+{
+    // GROUP CONSECUTIVE CHAINS UNTIL A TASK HOLDS grain UNITS OF WORK
+    mTasks.clear();
+
+    uint32_t cost = 0;
+    Task task;
+    task.mFirst = 0;
+    for(uint32_t c = 0; c < mSlots.size(); c++)
+    {
+        uint32_t bones = mSlots[c].mChain.GetBoneCount();
+        uint32_t effectors = mSlots[c].mEffectors.GetCount();
+        cost += bones*(effectors > 0 ? effectors : 1);
+        if(cost >= mGrain || c+1 == mSlots.size())
+        {
+            task.mLast = c+1;
+            mTasks.push_back(task);
+            task.mFirst = c+1;
+            cost = 0;
+        }
+    }
+
+    // CONTIGUOUS RUNS OF TASKS PER WORKER KEEP NEIGHBOURING CHAINS TOGETHER
+    uint32_t count = mTasks.size();
+    for(uint32_t w = 0; w < mWorkers.size(); w++)
+    {
+        Worker& worker = *mWorkers[w];
+        std::lock_guard<std::mutex> lock(worker.mMutex);
+        uint32_t first = count*w/mWorkers.size();
+        uint32_t last = count*(w+1)/mWorkers.size();
+        worker.mTasks.assign(mTasks.begin()+first, mTasks.begin()+last);
+        worker.mHead = 0;
+        worker.mTail = worker.mTasks.size();
+    }
+
+    mPending = count;
+}
+
+void FabrikWorld::RunWorker(uint32_t worker)
+{
+    Task task;
+    while(mPending.load() > 0)
+    {
+        if(!PopTask(worker, task) && !StealTask(worker, task))
+        {
+            if(mPending.load() == 0)
+            {
+                break;
+            }
+            std::this_thread::yield();
+            continue;
+        }
+
+        for(uint32_t c = task.mFirst; c < task.mLast; c++)
+        {
+            Slot& slot = mSlots[c];
+            slot.mChain.Solve(slot.mEffectors);
+        }
+
+        if(mPending.fetch_sub(1) == 1)
+        {
+            std::lock_guard<std::mutex> lock(mStateMutex);
+            mDone.notify_all();
+        }
+    }
+}
+
+bool FabrikWorld::PopTask(uint32_t worker, Task& task)
+{
+    Worker& own = *mWorkers[worker];
+    std::lock_guard<std::mutex> lock(own.mMutex);
+    if(own.mHead == own.mTail)
+    {
+        return false;
+    }
+    task = own.mTasks[--own.mTail];
+    return true;
+}
+
+bool FabrikWorld::StealTask(uint32_t worker, Task& task)
+{
+    for(uint32_t i = 1; i < mWorkers.size(); i++)
+    {
+        Worker& victim = *mWorkers[(worker+i)%mWorkers.size()];
+        std::lock_guard<std::mutex> lock(victim.mMutex);
+        if(victim.mHead == victim.mTail)
+        {
+            continue;
+        }
+        task = victim.mTasks[victim.mHead++];
+        return true;
+    }
+    return false;
+}
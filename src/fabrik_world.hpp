@@ -0,0 +1,117 @@
+#ifndef FABRIKPD2D_WORLD_HPP
+#define FABRIKPD2D_WORLD_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "fabrik.hpp"
+
+// OWNS MANY CHAINS AND SOLVES THEM ALL EACH FRAME ON A WORK-STEALING POOL.
+// EVERY CHAIN IS SOLVED BY EXACTLY ONE THREAD AND CHAINS DO NOT INTERACT,
+// SO RESULTS ARE THE SAME FOR ANY THREAD COUNT. CHAINS SHARING A FabrikScan
+// ARE SAFE BUT TAKE TURNS ON IT.
+class FabrikWorld
+{
+    public:
+
+    FabrikWorld();
+    ~FabrikWorld();
+
+    FabrikWorld(const FabrikWorld&) = delete;
+    FabrikWorld& operator=(const FabrikWorld&) = delete;
+
+    // RETURNS THE CHAIN INDEX. REFERENCES FROM GetChain/GetEffectors ARE
+    // INVALIDATED BY THE NEXT AddChain.
+    uint32_t AddChain();
+    uint32_t GetChainCount();
+
+    FabrikPD2D& GetChain(uint32_t chain);
+    FabrikPD2D::EffectorSet& GetEffectors(uint32_t chain);
+
+    // THREADS INCLUDING THE CALLER OF Solve, 0 PICKS THE HARDWARE CONCURRENCY
+    void SetThreads(uint32_t threads);
+    uint32_t GetThreads();
+
+    // CHAINS ARE GROUPED INTO TASKS OF AT LEAST grain BONE-EFFECTOR SOLVES.
+    // A CHAIN IS NEVER SPLIT, A LARGE ONE IS A TASK ON ITS OWN.
+    void SetGrain(uint32_t grain);
+    uint32_t GetGrain();
+
+    // SOLVES EVERY CHAIN WITH THE TARGETS STORED IN ITS EFFECTOR SET
+    void Solve();
+
+    private:
+
+    // ONE CACHE LINE OR MORE PER CHAIN SO THE SLOTS OF NEIGHBOURING CHAINS
+    // SOLVED BY DIFFERENT THREADS NEVER SHARE A LINE. ONLY THE SLOT IS
+    // ALIGNED: THE POSE, FK CACHE AND SCRATCH OF A CHAIN ARE ITS OWN HEAP
+    // ARRAYS, SIZED ONCE AND ONLY WRITTEN BY THE THREAD SOLVING IT, WHERE TWO
+    // CHAINS CAN AT MOST SHARE THE LINE AT THE EDGE OF AN ARRAY.
+    class alignas(64) Slot
+    {
+        private:
+
+        FabrikPD2D mChain;
+        FabrikPD2D::EffectorSet mEffectors;
+
+        friend class FabrikWorld;
+    };
+
+    class Task
+    {
+        private:
+
+        uint32_t mFirst;
+        uint32_t mLast;
+
+        friend class FabrikWorld;
+    };
+
+    // PER THREAD STATE: A DEQUE OF TASKS, THE OWNER POPS FROM THE BACK AND
+    // THIEVES TAKE FROM THE FRONT
+    class alignas(64) Worker
+    {
+        private:
+
+        Worker();
+
+        std::mutex mMutex;
+        std::vector<Task> mTasks;
+        uint32_t mHead;
+        uint32_t mTail;
+
+        friend class FabrikWorld;
+    };
+
+    void StartThreads();
+    void StopThreads();
+    void ThreadMain(uint32_t worker);
+
+    void BuildTasks();
+    void RunWorker(uint32_t worker);
+    bool PopTask(uint32_t worker, Task& task);
+    bool StealTask(uint32_t worker, Task& task);
+
+    std::vector<Slot> mSlots;
+    uint32_t mGrain;
+    std::vector<Task> mTasks;
+
+    uint32_t mThreadCount;
+    std::vector<std::thread> mThreads;
+    std::vector<std::unique_ptr<Worker>> mWorkers;
+
+    std::mutex mStateMutex;
+    std::condition_variable mStart;
+    std::condition_variable mDone;
+    uint64_t mGeneration;
+    uint32_t mBusy;
+    bool mQuit;
+    std::atomic<uint32_t> mPending;
+};
+
+#endif
@@ -0,0 +1,29 @@
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+// THE REPLACED operator new AND delete OF test_solver. THEY LIVE APART FROM
+// THE CHECKS SO THE COMPILER CANNOT INLINE THEM INTO THE CONTAINERS THERE
+// AND MISTAKE THE free FOR A MISMATCHED delete.
+uint64_t gAllocations = 0;
+
+void* operator new(size_t size)
+{
+    ++gAllocations;
+    void* memory = malloc(size > 0 ? size : 1);
+    if(memory == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    free(memory);
+}
@@ -0,0 +1,1168 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fabrik.hpp>
+#include <fabrik_batch.hpp>
+#include <fabrik_chain.hpp>
+#include <fabrik_reach.hpp>
+#include <fabrik_rig.hpp>
+#include <fabrik_scan.hpp>
+#include <fabrik_world.hpp>
+
+// HEADLESS CHECKS OF WHAT THE SOLVER PROMISES, RUN BY ctest. EVERY FAILED
+// CHECK IS PRINTED AND THE EXIT CODE IS THE NUMBER OF FAILURES.
+
+static uint32_t gFailures = 0;
+
+static void Check(bool passed, const char* what)
+{
+    if(!passed)
+    {
+        printf("FAILED: %s\n", what);
+        ++gFailures;
+    }
+}
+
+// EVERY HEAP ALLOCATION IN THE PROCESS, COUNTED BY allocations.cpp
+extern uint64_t gAllocations;
+
+static uint32_t gSeed = 12345;
+static float Random(float min, float max)
+{
+    gSeed = gSeed*1103515245u+12345u;
+    return min+(max-min)*((gSeed>>8)&0xFFFF)/65535.f;
+}
+
+// A LINEAR CHAIN OF bones BONES OF LENGTH 10, SLIGHTLY BENT
+static void MakeChain(FabrikPD2D& rig, uint32_t bones)
+{
+    const float length = 10;
+    rig.AddRoot({0, 0}, {length, 0});
+    for(uint32_t b = 2; b <= bones; b++)
+    {
+        rig.AddBone({length*b, Random(-2, 2)});
+    }
+}
+
+static bool Near(float a, float b)
+{
+    return fabsf(a-b) < 1e-3f;
+}
+
+// ANGLES READ BACK IN THE DEGREES OF THE LIMIT, SO A POSE PAST THE 180 SEAM
+// UNDER A LIMIT WIDER THAN IT SURVIVES GetTheta, SetTheta AND NEW LIMITS
+template<class Rig>
+static bool SeamHolds(Rig& rig)
+{
+    rig.SetMinTheta(2, 90);
+    rig.SetMaxTheta(2, 270);
+    rig.SetTheta(2, 200);
+    FabrikVec2 end = rig.GetBoneEnd(3);
+    bool held = Near(rig.GetTheta(2), 200);
+    rig.SetTheta(2, rig.GetTheta(2));
+    held = held && Near(rig.GetTheta(2), 200) && FabrikFloat::Distance(rig.GetBoneEnd(3), end) < 1e-3f;
+
+    // NARROWING AROUND THE POSE KEEPS IT, NARROWING PAST IT CLAMPS
+    rig.SetMinTheta(2, 120);
+    rig.SetMaxTheta(2, 250);
+    held = held && Near(rig.GetTheta(2), 200) && FabrikFloat::Distance(rig.GetBoneEnd(3), end) < 1e-3f;
+    rig.SetMaxTheta(2, 190);
+    held = held && Near(rig.GetTheta(2), 190);
+
+    // THE OTHER SIDE OF THE SEAM
+    rig.SetMinTheta(3, -270);
+    rig.SetMaxTheta(3, -90);
+    rig.SetTheta(3, -200);
+    held = held && Near(rig.GetTheta(3), -200);
+    rig.SetMinTheta(3, -220);
+    held = held && Near(rig.GetTheta(3), -200);
+    rig.SetMinTheta(3, -190);
+    held = held && Near(rig.GetTheta(3), -190);
+
+    // A FREE JOINT STILL READS (-180, 180]
+    rig.SetTheta(1, 170);
+    held = held && Near(rig.GetTheta(1), 170);
+    rig.SetTheta(1, -170);
+    return held && Near(rig.GetTheta(1), -170);
+}
+
+static void TestThetaSeam()
+{
+    FabrikPD2D rig;
+    MakeChain(rig, 3);
+    Check(SeamHolds(rig), "theta: angles past the seam keep their degrees");
+
+    FabrikVec2 joints[4] = {{0, 0}, {10, 0}, {20, 0}, {30, 0}};
+    FabrikChain<3, FabrikLimited, FabrikFloat> chain;
+    chain.SetJoints(joints);
+    Check(SeamHolds(chain), "theta: chain angles past the seam keep their degrees");
+}
+
+static float MaxDistance(FabrikPD2D& a, FabrikPD2D& b)
+{
+    float distance = a.GetBoneCount() == b.GetBoneCount() ? 0 : 1e9f;
+    for(uint32_t bone = 1; bone <= a.GetBoneCount() && bone <= b.GetBoneCount(); bone++)
+    {
+        distance = fmaxf(distance, FabrikFloat::Distance(a.GetBoneEnd(bone), b.GetBoneEnd(bone)));
+    }
+    return distance;
+}
+
+// BuildChain IS AddRoot/AddBone WITH THE LIMITS SET AFTER EACH BONE, A
+// JOINT CLAMPED INTO ITS LIMITS AND ONE CLAMPED PAST THE 180 SEAM INCLUDED
+static void TestBuildChain()
+{
+    const uint32_t count = 7;
+    const FabrikVec2 joints[count] = {{0, 0}, {10, 0}, {15, 10}, {12.26f, -2.7f}, {5, -10}, {0, -20}, {10, -25}};
+    const float minThetas[count] = {0, -180, -30, 190, -45, -270, -20};
+    const float maxThetas[count] = {0, 180, 30, 270, 45, -90, 20};
+
+    FabrikPD2D built;
+    built.BuildChain(joints, count, minThetas, maxThetas);
+    FabrikPD2D added;
+    added.AddRoot(joints[0], joints[1]);
+    added.SetMinTheta(1, minThetas[1]);
+    added.SetMaxTheta(1, maxThetas[1]);
+    for(uint32_t b = 2; b < count; b++)
+    {
+        added.AddBone(joints[b]);
+        added.SetMinTheta(b, minThetas[b]);
+        added.SetMaxTheta(b, maxThetas[b]);
+    }
+
+    bool same = built.GetBoneCount() == count-1 && added.GetBoneCount() == count-1;
+    for(uint32_t b = 1; same && b < count; b++)
+    {
+        same = built.GetTheta(b) == added.GetTheta(b) && built.GetMinTheta(b) == added.GetMinTheta(b)
+            && built.GetMaxTheta(b) == added.GetMaxTheta(b);
+    }
+    Check(same, "BuildChain: the same angles and limits as AddBone");
+    Check(MaxDistance(built, added) == 0, "BuildChain: the same bone ends as AddBone");
+    Check(Near(built.GetTheta(2), 30) && Near(built.GetTheta(3), 190),
+        "BuildChain: joints outside their limits are clamped, past the seam too");
+
+    FabrikPD2D::EffectorSet effectors[2];
+    FabrikPD2D* rigs[2] = {&built, &added};
+    bool solved = true;
+    for(uint32_t frame = 0; frame < 10; frame++)
+    {
+        FabrikVec2 target = FabrikVec2{Random(-50, 50), Random(-50, 50)};
+        for(uint32_t r = 0; r < 2; r++)
+        {
+            if(frame == 0)
+            {
+                effectors[r].Add(count-1, false);
+            }
+            effectors[r].SetTarget(0, target);
+            rigs[r]->Solve(effectors[r]);
+        }
+        solved = solved && MaxDistance(built, added) == 0;
+    }
+    Check(solved, "BuildChain: solves like AddBone");
+}
+
+// THE LEGACY VECTOR Solve KEEPS ITS SET, SO CALLING IT AGAIN WITH THE SAME
+// TARGETS IS SKIPPED LIKE Solve(EffectorSet)
+static void TestLegacySkip()
+{
+    FabrikPD2D rig;
+    MakeChain(rig, 8);
+    rig.SetCollectStats(true);
+
+    std::vector<uint32_t> effectors = {4, 8};
+    std::vector<FabrikVec2> targets = {FabrikVec2{25, 15}, FabrikVec2{40, 30}};
+    std::vector<bool> fixed = {true, false};
+    rig.Solve(effectors, targets, fixed);
+
+    const FabrikPD2D::SolveStats& first = rig.GetLastStats();
+    bool solved = first.mEffectors.size() == 2;
+    for(const FabrikPD2D::SolveStats::Effector& effector : first.mEffectors)
+    {
+        solved = solved && effector.mTermination != FabrikReachStats::TERMINATION_SKIPPED;
+    }
+    Check(solved, "legacy Solve: the first call solves");
+
+    for(uint32_t repeat = 0; repeat < 3; repeat++)
+    {
+        rig.Solve(effectors, targets, fixed);
+        const FabrikPD2D::SolveStats& stats = rig.GetLastStats();
+        bool skipped = stats.mEffectors.size() == 2;
+        for(const FabrikPD2D::SolveStats::Effector& effector : stats.mEffectors)
+        {
+            skipped = skipped && effector.mTermination == FabrikReachStats::TERMINATION_SKIPPED;
+        }
+        Check(skipped, "legacy Solve: identical calls are skipped");
+    }
+
+    // A NEW FLAG IS A NEW SET OF SEGMENTS
+    fixed[0] = false;
+    rig.Solve(effectors, targets, fixed);
+    Check(rig.GetLastStats().mEffectors[1].mTermination != FabrikReachStats::TERMINATION_SKIPPED,
+        "legacy Solve: a changed flag solves again");
+}
+
+static bool Skipped(FabrikPD2D& rig, uint32_t effector)
+{
+    return rig.GetLastStats().mEffectors[effector].mTermination == FabrikReachStats::TERMINATION_SKIPPED;
+}
+
+// ONLY SEGMENTS NO OTHER SEGMENT SOLVES KEEP THEIR POSE WHEN A LATER TARGET MOVES
+static void TestSegmentSkip()
+{
+    for(bool fixed : {true, false})
+    {
+        FabrikPD2D rig;
+        MakeChain(rig, 12);
+        rig.SetCollectStats(true);
+
+        FabrikPD2D::EffectorSet effectors;
+        uint32_t first = effectors.Add(4, fixed);
+        uint32_t second = effectors.Add(8, true);
+        uint32_t third = effectors.Add(12, false);
+        effectors.SetTarget(first, FabrikVec2{25, 15});
+        effectors.SetTarget(second, FabrikVec2{50, 30});
+        effectors.SetTarget(third, FabrikVec2{80, 20});
+        rig.Solve(effectors);
+
+        effectors.SetTarget(third, FabrikVec2{75, 35});
+        rig.Solve(effectors);
+        if(fixed)
+        {
+            Check(Skipped(rig, first) && Skipped(rig, second) && !Skipped(rig, third),
+                "segments: pinned segments before the change keep their pose");
+        }
+        else
+        {
+            // THE SECOND SEGMENT STARTS AT THE ROOT AND DRAGS THE FIRST
+            Check(!Skipped(rig, first) && !Skipped(rig, second) && !Skipped(rig, third),
+                "segments: a segment another one solves is solved again");
+        }
+    }
+}
+
+// ONCE THE SCRATCH IS SIZED A SOLVE MAKES NO HEAP ALLOCATION, THROUGH EITHER
+// ENTRY POINT AND WITH THE TARGETS MOVING EVERY FRAME
+static void TestNoAllocations()
+{
+    FabrikPD2D rig;
+    MakeChain(rig, 16);
+
+    std::vector<uint32_t> bones = {5, 10, 16};
+    std::vector<FabrikVec2> targets = {FabrikVec2{30, 20}, FabrikVec2{60, 40}, FabrikVec2{100, 30}};
+    std::vector<bool> fixed = {true, false, false};
+    rig.Solve(bones, targets, fixed);
+
+    uint64_t allocations = gAllocations;
+    uint32_t scratchAllocations = rig.GetScratchAllocations();
+    for(uint32_t f = 0; f < 100; f++)
+    {
+        for(FabrikVec2& target : targets)
+        {
+            target = target+FabrikVec2{Random(-1, 1), Random(-1, 1)};
+        }
+        rig.Solve(bones, targets, fixed);
+    }
+    Check(gAllocations == allocations, "allocations: the vector Solve makes none");
+    Check(rig.GetScratchAllocations() == scratchAllocations, "allocations: the vector Solve keeps its scratch");
+
+    FabrikPD2D::EffectorSet effectors;
+    for(uint32_t i = 0; i < bones.size(); i++)
+    {
+        effectors.SetTarget(effectors.Add(bones[i], fixed[i]), targets[i]);
+    }
+    rig.SetCollectStats(true);
+    rig.Solve(effectors, targets.data(), targets.size());
+
+    allocations = gAllocations;
+    for(uint32_t f = 0; f < 100; f++)
+    {
+        for(FabrikVec2& target : targets)
+        {
+            target = target+FabrikVec2{Random(-1, 1), Random(-1, 1)};
+        }
+        rig.Solve(effectors, targets.data(), targets.size());
+    }
+    Check(gAllocations == allocations, "allocations: Solve(EffectorSet) makes none");
+}
+
+// BATCHED CHAINS REPORT THE STATS OF A ONE EFFECTOR Solve ON EVERY PATH
+static void TestBatchStats()
+{
+    for(FabrikBatch::Isa isa : {FabrikBatch::ISA_SCALAR, FabrikBatch::ISA_SSE, FabrikBatch::ISA_AVX2})
+    {
+        for(bool constrained : {false, true})
+        {
+            const uint32_t count = 11;
+            const uint32_t bones = 8;
+            std::vector<FabrikPD2D> chains(count);
+            std::vector<FabrikVec2> targets(count);
+            for(uint32_t c = 0; c < count; c++)
+            {
+                MakeChain(chains[c], bones);
+                if(constrained)
+                {
+                    for(uint32_t b = 2; b <= bones; b++)
+                    {
+                        chains[c].SetMinTheta(b, -40);
+                        chains[c].SetMaxTheta(b, 40);
+                    }
+                }
+                chains[c].SetCollectStats(true);
+                // SOME OUT OF REACH, THOSE ARE SOLVED IN CLOSED FORM
+                targets[c] = FabrikVec2{Random(-90, 90), Random(-90, 90)};
+            }
+            std::vector<FabrikPD2D> reference = chains;
+
+            FabrikBatch batch;
+            for(FabrikPD2D& chain : chains)
+            {
+                batch.AddChain(&chain);
+            }
+            batch.SetIsa(isa);
+            batch.Solve(bones, targets.data(), count);
+
+            bool same = true;
+            for(uint32_t c = 0; c < count; c++)
+            {
+                reference[c].Solve({bones}, {targets[c]}, {false});
+                const FabrikPD2D::SolveStats& expected = reference[c].GetLastStats();
+                const FabrikPD2D::SolveStats& stats = chains[c].GetLastStats();
+                same = same && stats.mEffectors.size() == 1 && stats.mEffectors[0].mBone == bones;
+                same = same && stats.mEffectors[0].mTermination == expected.mEffectors[0].mTermination;
+                same = same && stats.mEffectors[0].mIterations == expected.mEffectors[0].mIterations;
+                same = same && stats.mClamps == expected.mClamps;
+                same = same && fabsf(stats.mEffectors[0].mError-expected.mEffectors[0].mError) < 1e-3f;
+            }
+            Check(same, "batch: each chain reports the stats of its own Solve");
+        }
+    }
+}
+
+// ONE SUB-CHAIN FOR THE REACH KERNELS, IN A RANDOM POSE WITHIN ITS LIMITS
+class Reach
+{
+    public:
+
+    std::vector<FabrikVec2> mPositions;
+    std::vector<float> mLengths;
+    std::vector<FabrikLimit> mLimits;
+    std::vector<uint8_t> mPreferMin;
+    float mReach;
+    FabrikReachStats mStats;
+
+    // THE ITERATIONS ONLY STOP ONCE THE EFFECTOR NO LONGER MOVES
+    FabrikReachView GetView()
+    {
+        FabrikReachView view;
+        view.mPositions = mPositions.data();
+        view.mLengths = mLengths.data();
+        view.mLimits = mLimits.data();
+        view.mPreferMin = mPreferMin.data();
+        view.mNodes = mPositions.size();
+        view.mBaseStart = FabrikVec2{0, 0};
+        view.mBaseDirection = FabrikVec2{1, 0};
+        view.mReach = mReach;
+        view.mThreshold = 1e-4f;
+        view.mIterationThreshold = 1e-7f;
+        view.mIterationLimit = 10000;
+        mStats = FabrikReachStats();
+        view.mStats = &mStats;
+        return view;
+    }
+};
+
+static Reach MakeReach(uint32_t bones, bool constrained)
+{
+    Reach reach;
+    reach.mPositions.resize(bones+1);
+    reach.mLengths.resize(bones);
+    reach.mLimits.resize(bones);
+    reach.mPreferMin.resize(bones);
+    reach.mReach = 0;
+
+    FabrikVec2 direction = FabrikVec2{1, 0};
+    reach.mPositions[0] = FabrikVec2{0, 0};
+    for(uint32_t i = 0; i < bones; i++)
+    {
+        float minTheta = -30;
+        float maxTheta = 30;
+        if(constrained)
+        {
+            minTheta = Random(-90, -10);
+            maxTheta = Random(10, 90);
+            reach.mLimits[i].Set(minTheta, maxTheta);
+        }
+        FabrikVec2 rotation = FabrikFloat::RotationFromDegrees(Random(minTheta, maxTheta));
+        reach.mPreferMin[i] = reach.mLimits[i].PreferMin(rotation);
+
+        direction = RotateBy(direction, rotation);
+        reach.mLengths[i] = Random(5, 15);
+        reach.mPositions[i+1] = reach.mPositions[i]+direction*reach.mLengths[i];
+        reach.mReach += reach.mLengths[i];
+    }
+    return reach;
+}
+
+// TARGETS OUT OF REACH ARE LAID OUT IN ONE PASS: THE SAME POSE AS ITERATING
+// WITHOUT LIMITS. WITH THEM ONLY WHEN THE LIMITS ALLOW THE STRAIGHT LINE, AND
+// NEVER FARTHER FROM THE TARGET.
+static void TestClosedForm()
+{
+    for(bool constrained : {false, true})
+    {
+        bool passed = true;
+        uint32_t laidOutCount = 0;
+        for(uint32_t n = 0; n < 400; n++)
+        {
+            Reach closed = MakeReach(2+n%12, constrained);
+            Reach iterated = closed;
+
+            float angle = Random(-180, 180);
+            FabrikVec2 target = FabrikFloat::RotationFromDegrees(angle)*(closed.mReach*Random(1.05f, 3));
+
+            bool laidOut = constrained ? FabrikReachStraight<true>(closed.GetView(), target) : FabrikReachStraight<false>(closed.GetView(), target);
+            if(!laidOut)
+            {
+                // THE SOLVER ITERATES INSTEAD
+                passed = passed && constrained && closed.mStats.mTermination == FabrikReachStats::TERMINATION_NONE;
+                continue;
+            }
+            passed = passed && closed.mStats.mTermination == FabrikReachStats::TERMINATION_CLOSED_FORM;
+            ++laidOutCount;
+            if(constrained)
+            {
+                FabrikReachIterate<true, 0>(iterated.GetView(), target);
+            }
+            else
+            {
+                FabrikReachIterate<false, 0>(iterated.GetView(), target);
+            }
+
+            uint32_t effector = closed.mPositions.size()-1;
+            float closedError = FabrikFloat::Distance(closed.mPositions[effector], target);
+            float iteratedError = FabrikFloat::Distance(iterated.mPositions[effector], target);
+            float tolerance = 1e-4f*closed.mReach;
+            if(constrained)
+            {
+                passed = passed && closedError <= iteratedError+tolerance;
+            }
+            else
+            {
+                for(uint32_t i = 0; i <= effector; i++)
+                {
+                    passed = passed && FabrikFloat::Distance(closed.mPositions[i], iterated.mPositions[i]) <= tolerance;
+                }
+            }
+        }
+        Check(laidOutCount > 0, "closed form: some targets are laid out");
+        Check(passed, constrained ? "closed form: never farther than iterating with limits" : "closed form: the iterated pose without limits");
+    }
+}
+
+// ONE AND TWO BONE SUB-CHAINS ARE SOLVED EXACTLY: ON THE TARGET WITHOUT
+// LIMITS, NEVER FARTHER FROM IT THAN ITERATING WITH THEM
+static void TestAnalytic()
+{
+    for(bool constrained : {false, true})
+    {
+        bool passed = true;
+        for(uint32_t n = 0; n < 400; n++)
+        {
+            uint32_t bones = 1+n%2;
+            Reach analytic = MakeReach(bones, constrained);
+            Reach iterated = analytic;
+
+            // TWO BONES REACH AN ANNULUS, ONE BONE ONLY ITS CIRCLE
+            float inner = bones == 2 ? fabsf(analytic.mLengths[0]-analytic.mLengths[1]) : analytic.mReach;
+            float angle = Random(-180, 180);
+            FabrikVec2 target = FabrikFloat::RotationFromDegrees(angle)*Random(inner, analytic.mReach);
+
+            bool solved = constrained ? FabrikReachAnalytic<true>(analytic.GetView(), target) : FabrikReachAnalytic<false>(analytic.GetView(), target);
+            passed = passed && solved && analytic.mStats.mTermination == FabrikReachStats::TERMINATION_CLOSED_FORM;
+            if(constrained)
+            {
+                FabrikReachIterate<true, 0>(iterated.GetView(), target);
+            }
+            else
+            {
+                FabrikReachIterate<false, 0>(iterated.GetView(), target);
+            }
+
+            float analyticError = FabrikFloat::Distance(analytic.mPositions[bones], target);
+            float iteratedError = FabrikFloat::Distance(iterated.mPositions[bones], target);
+            float tolerance = 1e-4f*analytic.mReach;
+            passed = passed && analyticError <= iteratedError+tolerance;
+            if(!constrained)
+            {
+                passed = passed && analyticError <= tolerance;
+            }
+
+            // THE BONES KEEP THEIR LENGTHS
+            for(uint32_t i = 0; i < bones; i++)
+            {
+                float length = FabrikFloat::Distance(analytic.mPositions[i], analytic.mPositions[i+1]);
+                passed = passed && fabsf(length-analytic.mLengths[i]) <= tolerance;
+            }
+        }
+        Check(passed, constrained ? "analytic: never farther than iterating with limits" : "analytic: on the target without limits");
+    }
+}
+
+// A CHAIN SIZED AT RUNTIME SOLVES EXACTLY LIKE ONE SIZED AT COMPILE TIME
+template<class P>
+static bool SameAsFixedSize()
+{
+    typedef typename P::Vector V;
+
+    const uint32_t bones = 8;
+    std::vector<V> joints(bones+1);
+    for(uint32_t b = 0; b <= bones; b++)
+    {
+        joints[b] = V{P::FromFloat(10.f*b), P::FromFloat(Random(-2, 2))};
+    }
+    FabrikChain<bones, FabrikLimited, P> fixed;
+    FabrikChain<0, FabrikLimited, P> runtime(bones);
+    fixed.SetJoints(joints.data());
+    runtime.SetJoints(joints.data());
+    for(uint32_t b = 2; b <= bones; b++)
+    {
+        fixed.SetMinTheta(b, P::FromFloat(-40));
+        fixed.SetMaxTheta(b, P::FromFloat(40));
+        runtime.SetMinTheta(b, P::FromFloat(-40));
+        runtime.SetMaxTheta(b, P::FromFloat(40));
+    }
+
+    bool same = runtime.GetBoneCount() == bones;
+    for(uint32_t t = 0; t < 50; t++)
+    {
+        uint32_t effector = 2+t%(bones-1);
+        V target = V{P::FromFloat(Random(-90, 90)), P::FromFloat(Random(-90, 90))};
+        fixed.Solve(effector, target);
+        runtime.Solve(effector, target);
+        for(uint32_t b = 1; b <= bones; b++)
+        {
+            V a = fixed.GetBoneEnd(b);
+            V c = runtime.GetBoneEnd(b);
+            same = same && P::ToFloat(a.x) == P::ToFloat(c.x) && P::ToFloat(a.y) == P::ToFloat(c.y);
+        }
+    }
+    return same;
+}
+
+static void TestRuntimeChain()
+{
+    Check(SameAsFixedSize<FabrikFloat>(), "runtime chain: float matches the fixed size chain");
+    Check(SameAsFixedSize<FabrikDouble>(), "runtime chain: double matches the fixed size chain");
+    Check(SameAsFixedSize<FabrikFixed>(), "runtime chain: fixed point matches the fixed size chain");
+}
+
+// A Y: THREE TRUNK BONES ALONG x, TWO MIRRORED BRANCHES OF THREE FROM ITS END.
+// THE EFFECTORS ON THE LAST BONES TARGET THE ENDS OF BONES 5 AND 8.
+static void MakeFork(FabrikPD2D& rig)
+{
+    rig.AddRoot({0, 0}, {10, 0});
+    rig.AddBone({20, 0});
+    rig.AddBone({30, 0});
+    rig.AddBone(3, {37, 7});
+    rig.AddBone({44, 14});
+    rig.AddBone({51, 21});
+    rig.AddBone(3, {37, -7});
+    rig.AddBone({44, -14});
+    rig.AddBone({51, -21});
+}
+
+static bool ForkConverges(FabrikPD2D& rig, FabrikVec2 upper, FabrikVec2 lower)
+{
+    FabrikPD2D::EffectorSet effectors;
+    effectors.Add(6, false);
+    effectors.Add(9, false);
+    effectors.SetTarget(0, upper);
+    effectors.SetTarget(1, lower);
+    rig.SetCollectStats(true);
+    rig.Solve(effectors);
+    const FabrikPD2D::SolveStats& stats = rig.GetLastStats();
+    return stats.mEffectors.size() == 2
+        && stats.mEffectors[0].mTermination == FabrikReachStats::TERMINATION_CONVERGED
+        && stats.mEffectors[1].mTermination == FabrikReachStats::TERMINATION_CONVERGED
+        && FabrikFloat::Distance(rig.GetBoneEnd(5), upper) <= rig.GetThreshold()
+        && FabrikFloat::Distance(rig.GetBoneEnd(8), lower) <= rig.GetThreshold();
+}
+
+// TWO BRANCHES PULL ON THE SUB-BASE THEY SHARE, WHICH GOES TO THE CENTROID
+// OF THEIR PULLS, SO BOTH ENDS CAN CONVERGE WHERE NEITHER BRANCH ALONE
+// WOULD LEAVE IT
+static void TestMultiEnd()
+{
+    const FabrikVec2 upper = FabrikVec2{20, 30};
+    const FabrikVec2 lower = FabrikVec2{38, 8};
+    FabrikPD2D fork;
+    MakeFork(fork);
+    Check(fork.IsBranched(), "multi end: the fork is branched");
+    Check(ForkConverges(fork, upper, lower), "multi end: both ends converge");
+
+    // THE SUB-BASE IS WITHIN REACH OF BOTH TARGETS AND BOTH BRANCHES HANG FROM IT
+    FabrikVec2 subBase = fork.GetBoneEnd(3);
+    float reach = fork.GetLength(4)+fork.GetLength(5);
+    Check(FabrikFloat::Distance(subBase, upper) <= reach+fork.GetThreshold()
+        && FabrikFloat::Distance(subBase, lower) <= reach+fork.GetThreshold()
+        && fork.GetBoneStart(4).x == subBase.x && fork.GetBoneStart(4).y == subBase.y
+        && fork.GetBoneStart(7).x == subBase.x && fork.GetBoneStart(7).y == subBase.y,
+        "multi end: the sub-base is where the two branches agree");
+
+    // EITHER BRANCH ALONE PLACES THE SUB-BASE FOR ITSELF, THE OTHER END MISSES
+    for(uint32_t branch = 0; branch < 2; branch++)
+    {
+        FabrikPD2D single;
+        MakeFork(single);
+        FabrikPD2D::EffectorSet effectors;
+        effectors.Add(branch == 0 ? 6 : 9, false);
+        effectors.SetTarget(0, branch == 0 ? upper : lower);
+        single.Solve(effectors);
+        float missed = branch == 0 ? FabrikFloat::Distance(single.GetBoneEnd(8), lower)
+            : FabrikFloat::Distance(single.GetBoneEnd(5), upper);
+        Check(missed > 10*single.GetThreshold(), "multi end: one branch alone misses the other target");
+    }
+}
+
+// THE TAIL AFTER A MID-CHAIN EFFECTOR ONLY FOLLOWS WHEN IT IS READ, AND
+// THEN LANDS WHERE THE EAGER PASS OF FabrikChain PUTS IT
+static void TestLazyTail()
+{
+    const uint32_t bones = 16;
+    std::vector<FabrikVec2> joints(bones+1);
+    gSeed = 12345;
+    for(uint32_t b = 0; b <= bones; b++)
+    {
+        joints[b] = FabrikVec2{10.f*b, Random(-2, 2)};
+    }
+    FabrikPD2D lazy;
+    lazy.BuildChain(joints.data(), joints.size());
+    FabrikChain<0, FabrikLimited, FabrikFloat> eager(bones);
+    eager.SetJoints(joints.data());
+    for(uint32_t b = 2; b <= bones; b++)
+    {
+        lazy.SetMinTheta(b, -45);
+        lazy.SetMaxTheta(b, 45);
+        eager.SetMinTheta(b, -45);
+        eager.SetMaxTheta(b, 45);
+    }
+
+    bool same = true;
+    for(uint32_t frame = 0; frame < 30; frame++)
+    {
+        uint32_t effector = 4+frame%9;
+        FabrikVec2 target = FabrikVec2{Random(-60, 100), Random(-80, 80)};
+        FabrikPD2D::EffectorSet effectors;
+        effectors.Add(effector, false);
+        effectors.SetTarget(0, target);
+        lazy.Solve(effectors);
+        eager.Solve(effector, target);
+
+        // THE SOLVED BONES FIRST, THEN THE TAIL, FROM THE FAR END ON EVEN FRAMES
+        for(uint32_t i = 1; i <= bones; i++)
+        {
+            uint32_t b = frame%2 == 0 && i >= effector ? bones+effector-i : i;
+            FabrikVec2 a = lazy.GetBoneEnd(b);
+            FabrikVec2 c = eager.GetBoneEnd(b);
+            same = same && a.x == c.x && a.y == c.y;
+        }
+    }
+    Check(same, "lazy tail: every bone end matches the eager tail");
+}
+
+// STORING SOLVED JOINTS AND WORKING OUT THE ROTATIONS LATER GIVES THE SAME
+// POSES AS STORING ROTATIONS, WHATEVER RANGE IS STALE WHEN THEY ARE NEEDED
+static void TestCanonicalPositions()
+{
+    for(bool branched : {false, true})
+    {
+        FabrikPD2D rigs[2];
+        for(FabrikPD2D& rig : rigs)
+        {
+            gSeed = 12345;
+            MakeChain(rig, 12);
+            for(uint32_t b = 3; b <= 12; b += 2)
+            {
+                rig.SetMinTheta(b, -60);
+                rig.SetMaxTheta(b, 60);
+            }
+            if(branched)
+            {
+                rig.AddBone(6, {60, 20});
+                rig.AddBone({60, 30});
+            }
+        }
+        rigs[1].SetCanonical(FabrikPD2D::CANONICAL_POSITIONS);
+        uint32_t bones = rigs[0].GetBoneCount();
+
+        FabrikPD2D::EffectorSet effectors[2];
+        for(FabrikPD2D::EffectorSet& set : effectors)
+        {
+            set.Add(6, true);
+            set.Add(12, false);
+            if(branched)
+            {
+                set.Add(bones, false);
+            }
+        }
+
+        bool same = true;
+        for(uint32_t frame = 0; frame < 30; frame++)
+        {
+            FabrikVec2 targets[3] = {{Random(20, 50), Random(-30, 30)}, {Random(40, 110), Random(-60, 60)},
+                {Random(40, 80), Random(0, 50)}};
+            // A BONE TURNED INSIDE THE STALE RANGE, OR AFTER IT, BETWEEN SOLVES
+            uint32_t turned = 2+frame%11;
+            float theta = Random(-40, 40);
+            for(uint32_t r = 0; r < 2; r++)
+            {
+                for(uint32_t e = 0; e < effectors[r].GetCount(); e++)
+                {
+                    effectors[r].SetTarget(e, targets[e]);
+                }
+                rigs[r].Solve(effectors[r]);
+                if(frame%3 == 1)
+                {
+                    rigs[r].SetTheta(turned, theta);
+                }
+            }
+            // READ SOMETIMES THE ENDS, SOMETIMES THE ANGLES, SO BOTH ORDERS RUN
+            for(uint32_t b = 1; b <= bones; b++)
+            {
+                if(frame%2 == 0)
+                {
+                    FabrikVec2 a = rigs[0].GetBoneEnd(b);
+                    FabrikVec2 c = rigs[1].GetBoneEnd(b);
+                    same = same && a.x == c.x && a.y == c.y;
+                }
+                else if(b == turned)
+                {
+                    same = same && rigs[0].GetTheta(b) == rigs[1].GetTheta(b);
+                }
+            }
+        }
+        same = same && MaxDistance(rigs[0], rigs[1]) == 0;
+        for(uint32_t b = 1; b <= bones; b++)
+        {
+            same = same && rigs[0].GetTheta(b) == rigs[1].GetTheta(b);
+        }
+        Check(same, branched ? "positions: a branched rig solves as with rotations"
+            : "positions: a linear rig solves as with rotations");
+    }
+}
+
+// AN INSTANCE THAT EDITS ITS BONES GETS ITS OWN DEFINITION: IT SOLVES LIKE A
+// RIG BUILT WITH THE SAME EDITS, AND THE INSTANCES STILL SHARING DO NOT MOVE
+static void BuildShared(FabrikPD2D& rig)
+{
+    gSeed = 12345;
+    MakeChain(rig, 10);
+    for(uint32_t b = 2; b <= 10; b++)
+    {
+        rig.SetMinTheta(b, -60);
+        rig.SetMaxTheta(b, 60);
+    }
+}
+
+static void Edit(FabrikPD2D& rig)
+{
+    rig.SetLength(4, 15);
+    rig.SetMaxTheta(7, 20);
+}
+
+static bool SamePose(FabrikPD2D& a, FabrikPD2D& b)
+{
+    bool same = a.GetBoneCount() == b.GetBoneCount();
+    for(uint32_t bone = 1; same && bone <= a.GetBoneCount(); bone++)
+    {
+        FabrikVec2 endA = a.GetBoneEnd(bone);
+        FabrikVec2 endB = b.GetBoneEnd(bone);
+        same = endA.x == endB.x && endA.y == endB.y;
+    }
+    return same;
+}
+
+static void TestSharedDefinition()
+{
+    FabrikPD2D prototype;
+    BuildShared(prototype);
+    FabrikPD2D edited(prototype.GetDefinition());
+    FabrikPD2D shared(prototype.GetDefinition());
+    Edit(edited);
+
+    FabrikPD2D deep;
+    BuildShared(deep);
+    Edit(deep);
+
+    Check(shared.GetDefinition() == prototype.GetDefinition() && edited.GetDefinition() != prototype.GetDefinition(),
+        "shared definition: only the edited instance copies it");
+
+    bool editedSame = true;
+    bool sharedSame = true;
+    FabrikPD2D* rigs[4] = {&prototype, &edited, &shared, &deep};
+    FabrikPD2D::EffectorSet effectors[4];
+    for(uint32_t frame = 0; frame < 20; frame++)
+    {
+        FabrikVec2 middle = FabrikVec2{Random(10, 50), Random(-30, 30)};
+        FabrikVec2 end = FabrikVec2{Random(30, 110), Random(-60, 60)};
+        for(uint32_t r = 0; r < 4; r++)
+        {
+            if(frame == 0)
+            {
+                effectors[r].Add(5, true);
+                effectors[r].Add(10, false);
+            }
+            effectors[r].SetTarget(0, middle);
+            effectors[r].SetTarget(1, end);
+            rigs[r]->Solve(effectors[r]);
+        }
+        editedSame = editedSame && SamePose(edited, deep);
+        sharedSame = sharedSame && SamePose(shared, prototype);
+    }
+    Check(editedSame, "shared definition: a copied on write instance solves like a deep copy");
+    Check(sharedSame, "shared definition: the instances still sharing are unaffected by the edit");
+    Check(!SamePose(edited, shared), "shared definition: the edit changes the pose");
+}
+
+// JSON TO PACK TO JSON KEEPS THE POSE, ANGLES PAST THE 180 SEAM INCLUDED
+static void TestRigRoundTrip()
+{
+    const char* text =
+        "{\"rigs\": [{\"base\": {\"position\": [5, -5], \"theta\": 30}, \"bones\": ["
+        "{\"length\": 10},"
+        "{\"length\": 10, \"theta\": 200, \"minTheta\": 90, \"maxTheta\": 270},"
+        "{\"length\": 10, \"theta\": -200, \"minTheta\": -270, \"maxTheta\": -90},"
+        "{\"parent\": 1, \"length\": 5, \"theta\": 45, \"minTheta\": -60, \"maxTheta\": 60}"
+        "]}]}";
+    std::vector<FabrikPD2D> read;
+    std::string error;
+    Check(FabrikRigJson::Read(text, strlen(text), read, error) && read.size() == 1, "rig round trip: the JSON reads");
+    if(read.size() != 1)
+    {
+        return;
+    }
+    Check(Near(read[0].GetTheta(2), 200) && Near(read[0].GetTheta(3), -200), "rig round trip: angles read as written");
+
+    std::vector<uint8_t> pack;
+    FabrikRigPack::Write(read, pack);
+    FabrikRigPack opened;
+    std::vector<FabrikPD2D> loaded(1);
+    Check(opened.Open(pack.data(), pack.size()) && opened.GetRig(0).Load(loaded[0]), "rig round trip: the pack loads");
+
+    std::string written;
+    FabrikRigJson::Write(loaded, written);
+    std::vector<FabrikPD2D> again;
+    Check(FabrikRigJson::Read(written.data(), written.size(), again, error) && again.size() == 1,
+        "rig round trip: the written JSON reads");
+    if(again.size() != 1)
+    {
+        return;
+    }
+    Check(MaxDistance(read[0], loaded[0]) == 0, "rig round trip: the pack keeps every bone end");
+    Check(MaxDistance(read[0], again[0]) < 1e-3f, "rig round trip: the JSON keeps every bone end");
+}
+
+// EvaluateTargets IS A COPY OF THE RIG SOLVED FOR EACH CANDIDATE, EXCEPT
+// THAT CANDIDATES OUTSIDE THE ANNULUS ARE REJECTED WITHOUT SOLVING
+static void TestEvaluateTargets()
+{
+    FabrikPD2D rig;
+    MakeChain(rig, 8);
+    for(uint32_t b = 2; b <= 8; b++)
+    {
+        rig.SetMinTheta(b, -70);
+        rig.SetMaxTheta(b, 70);
+    }
+    // THE FIRST BONE OUTREACHES THE NEXT THREE, THE ANNULUS HAS A HOLE
+    rig.SetLength(1, 45);
+    const uint32_t effector = 5;
+    float outer = 0;
+    for(uint32_t b = 1; b < effector; b++)
+    {
+        outer += rig.GetLength(b);
+    }
+    float inner = 2*rig.GetLength(1)-outer;
+
+    std::vector<FabrikVec2> candidates;
+    for(uint32_t c = 0; c < 40; c++)
+    {
+        candidates.push_back(FabrikVec2{Random(-80, 80), Random(-80, 80)});
+    }
+    candidates.push_back(FabrikVec2{3, 4});
+    candidates.push_back(FabrikVec2{90, 10});
+    std::vector<FabrikPD2D::TargetResult> results(candidates.size());
+    std::vector<FabrikVec2> poses(candidates.size()*effector);
+    std::vector<FabrikVec2> current(effector);
+    current[0] = rig.GetBoneStart(1);
+    for(uint32_t j = 1; j < effector; j++)
+    {
+        current[j] = rig.GetBoneEnd(j);
+    }
+    Check(rig.EvaluateTargets(effector, candidates.data(), candidates.size(), results.data(), poses.data()),
+        "evaluate: a linear chain is evaluated");
+
+    bool same = true;
+    bool rejected = true;
+    uint32_t rejections = 0;
+    for(uint32_t c = 0; c < candidates.size(); c++)
+    {
+        const FabrikPD2D::TargetResult& result = results[c];
+        const FabrikVec2* pose = &poses[c*effector];
+        float distance = FabrikFloat::Distance(current[0], candidates[c]);
+        float outside = distance > outer ? distance-outer : inner-distance;
+        if(outside > rig.GetThreshold())
+        {
+            // THE ANNULUS BOUND AND THE CURRENT JOINTS, NOTHING WAS SOLVED
+            rejected = rejected && result.mRejected && !result.mReachable && Near(result.mError, outside);
+            for(uint32_t j = 0; j < effector; j++)
+            {
+                rejected = rejected && pose[j].x == current[j].x && pose[j].y == current[j].y;
+            }
+            ++rejections;
+            continue;
+        }
+
+        FabrikPD2D copy = rig;
+        FabrikPD2D::EffectorSet effectors;
+        effectors.Add(effector, false);
+        effectors.SetTarget(0, candidates[c]);
+        copy.Solve(effectors);
+        FabrikVec2 end = copy.GetBoneEnd(effector-1);
+        float error = FabrikFloat::Distance(end, candidates[c]);
+        same = same && !result.mRejected && result.mError == error && result.mReachable == (error <= rig.GetThreshold());
+        same = same && pose[0].x == copy.GetBoneStart(1).x && pose[0].y == copy.GetBoneStart(1).y;
+        for(uint32_t j = 1; j < effector; j++)
+        {
+            same = same && pose[j].x == copy.GetBoneEnd(j).x && pose[j].y == copy.GetBoneEnd(j).y;
+        }
+    }
+    Check(same, "evaluate: every candidate matches solving a copy");
+    Check(rejected && rejections >= 2, "evaluate: candidates outside the annulus are rejected, not solved");
+
+    // THE RIG ITSELF IS LEFT AS IT WAS
+    bool kept = true;
+    for(uint32_t j = 1; j < effector; j++)
+    {
+        kept = kept && rig.GetBoneEnd(j).x == current[j].x && rig.GetBoneEnd(j).y == current[j].y;
+    }
+    Check(kept, "evaluate: the pose is left as it was");
+}
+
+// A ROPE OF SHORT, SLIGHTLY BENT BONES, LONG ENOUGH FOR MANY SCAN BLOCKS
+static void MakeRope(FabrikPD2D& rope, uint32_t bones)
+{
+    gSeed = 12345;
+    std::vector<FabrikVec2> joints(bones+1);
+    float angle = 0;
+    joints[0] = FabrikVec2{0, 0};
+    for(uint32_t j = 1; j <= bones; j++)
+    {
+        angle += Random(-0.05f, 0.05f);
+        joints[j] = joints[j-1]+FabrikVec2{cosf(angle), sinf(angle)};
+    }
+    rope.BuildChain(joints.data(), joints.size());
+}
+
+// THE SCAN IS THE SERIAL SWEEP WITH ONE THREAD, AND WITH MORE THE SAME
+// RESULT WHATEVER THE COUNT, A FEW ULPS PER BLOCK FROM THE SWEEP
+static void TestScan()
+{
+    const uint32_t bones = 5000;
+    FabrikPD2D serial;
+    MakeRope(serial, bones);
+
+    FabrikPD2D ropes[3];
+    FabrikScan scans[3];
+    const uint32_t threads[3] = {1, 2, 4};
+    for(uint32_t r = 0; r < 3; r++)
+    {
+        MakeRope(ropes[r], bones);
+        scans[r].SetThreads(threads[r]);
+        scans[r].SetBlock(64);
+        ropes[r].SetScan(&scans[r]);
+    }
+
+    bool exact = true;
+    bool same = true;
+    float error = 0;
+    for(uint32_t frame = 0; frame < 10; frame++)
+    {
+        float theta = Random(-3, 3);
+        serial.SetTheta(1, theta);
+        for(FabrikPD2D& rope : ropes)
+        {
+            rope.SetTheta(1, theta);
+        }
+        for(uint32_t b = 1; b <= bones; b++)
+        {
+            FabrikVec2 end = serial.GetBoneEnd(b);
+            FabrikVec2 one = ropes[0].GetBoneEnd(b);
+            FabrikVec2 two = ropes[1].GetBoneEnd(b);
+            FabrikVec2 four = ropes[2].GetBoneEnd(b);
+            exact = exact && one.x == end.x && one.y == end.y;
+            same = same && two.x == four.x && two.y == four.y;
+            error = fmaxf(error, FabrikFloat::Distance(four, end));
+        }
+    }
+    Check(exact, "scan: one thread is the serial sweep");
+    Check(same, "scan: the result does not depend on the thread count");
+    // THE ROPE IS bones LONG, THE ENDS STAY WITHIN 2e-5 OF ITS LENGTH
+    Check(error < 2e-5f*bones, "scan: blocks carried in match the serial sweep");
+}
+
+// EVERY BONE END OF A CROWD AFTER A FEW FRAMES, SOLVED ON threads THREADS.
+// HALF THE CHAINS SHARE ONE SCAN, WHICH THE WORKERS MUST TAKE TURNS ON.
+static std::vector<FabrikVec2> SolveCrowd(uint32_t threads)
+{
+    FabrikScan scan;
+    scan.SetThreads(2);
+    scan.SetBlock(8);
+
+    FabrikWorld world;
+    world.SetThreads(threads);
+    world.SetGrain(16);
+    gSeed = 12345;
+    const uint32_t chains = 64;
+    for(uint32_t c = 0; c < chains; c++)
+    {
+        world.AddChain();
+    }
+    for(uint32_t c = 0; c < chains; c++)
+    {
+        FabrikPD2D& chain = world.GetChain(c);
+        uint32_t bones = 4+c%29;
+        MakeChain(chain, bones);
+        for(uint32_t b = 2; b <= bones; b += 3)
+        {
+            chain.SetMinTheta(b, -50);
+            chain.SetMaxTheta(b, 50);
+        }
+        if(c%2 == 0)
+        {
+            chain.SetScan(&scan);
+        }
+        FabrikPD2D::EffectorSet& effectors = world.GetEffectors(c);
+        if(bones > 8)
+        {
+            effectors.Add(bones/2, c%3 == 0);
+        }
+        effectors.Add(bones, false);
+    }
+
+    std::vector<FabrikVec2> ends;
+    for(uint32_t frame = 0; frame < 5; frame++)
+    {
+        for(uint32_t c = 0; c < chains; c++)
+        {
+            FabrikPD2D::EffectorSet& effectors = world.GetEffectors(c);
+            float reach = 10.f*world.GetChain(c).GetBoneCount();
+            for(uint32_t e = 0; e < effectors.GetCount(); e++)
+            {
+                effectors.SetTarget(e, FabrikVec2{Random(-reach, reach), Random(-reach, reach)});
+            }
+        }
+        world.Solve();
+    }
+    for(uint32_t c = 0; c < chains; c++)
+    {
+        FabrikPD2D& chain = world.GetChain(c);
+        for(uint32_t b = 1; b <= chain.GetBoneCount(); b++)
+        {
+            ends.push_back(chain.GetBoneEnd(b));
+        }
+    }
+    return ends;
+}
+
+static void TestWorldThreads()
+{
+    std::vector<FabrikVec2> serial = SolveCrowd(1);
+    for(uint32_t threads : {2u, 4u, 8u})
+    {
+        std::vector<FabrikVec2> ends = SolveCrowd(threads);
+        bool same = ends.size() == serial.size();
+        for(uint32_t i = 0; same && i < ends.size(); i++)
+        {
+            same = ends[i].x == serial[i].x && ends[i].y == serial[i].y;
+        }
+        Check(same, "world: every thread count solves the crowd like one thread");
+    }
+}
+
+// A PACK IS TRUSTED ONLY AS FAR AS IT IS CHECKED: THE LINEAR PATHS NEED THE
+// BRANCHED FLAG TO MATCH THE LINKS AND THE REACH NEEDS THE LENGTH SUMS
+static bool LoadsAfter(const std::vector<uint8_t>& pack, uint32_t rig, uint64_t at, uint32_t value)
+{
+    std::vector<uint8_t> changed = pack;
+    memcpy(changed.data()+at, &value, sizeof(value));
+    FabrikRigPack opened;
+    FabrikPD2D loaded;
+    return opened.Open(changed.data(), changed.size()) && opened.GetRig(rig).Load(loaded);
+}
+
+static void TestRigPackChecks()
+{
+    std::vector<FabrikPD2D> rigs(2);
+    MakeChain(rigs[0], 6);
+    MakeChain(rigs[1], 3);
+    rigs[1].AddBone(1, {10, 10});
+    rigs[1].AddBone(4, {10, 20});
+
+    std::vector<uint8_t> pack;
+    FabrikRigPack::Write(rigs, pack);
+    FabrikRigPack opened;
+    Check(opened.Open(pack.data(), pack.size()), "rig pack: opens");
+    FabrikPD2D loaded;
+    Check(opened.GetRig(0).Load(loaded) && opened.GetRig(1).Load(loaded), "rig pack: both rigs load");
+
+    // AS FabrikRigHeader LAYS THEM OUT: RIG OFFSETS AFTER THE 32 BYTE PACK
+    // HEADER, mBranched AT 4 AND THE mLengthSums OFFSET AT 80
+    for(uint32_t r = 0; r < 2; r++)
+    {
+        uint64_t rig;
+        uint64_t lengthSums;
+        memcpy(&rig, pack.data()+32+r*sizeof(uint64_t), sizeof(rig));
+        memcpy(&lengthSums, pack.data()+rig+80, sizeof(lengthSums));
+        uint32_t branched = r == 0 ? 1 : 0;
+        float sum;
+        memcpy(&sum, pack.data()+rig+lengthSums+2*sizeof(float), sizeof(sum));
+        sum += 1;
+        uint32_t bits;
+        memcpy(&bits, &sum, sizeof(bits));
+
+        Check(!LoadsAfter(pack, r, rig+4, branched), "rig pack: a wrong branched flag is rejected");
+        Check(!LoadsAfter(pack, r, rig+lengthSums+2*sizeof(float), bits), "rig pack: a wrong length sum is rejected");
+    }
+}
+
+int main()
+{
+    TestThetaSeam();
+    TestBuildChain();
+    TestLegacySkip();
+    TestSegmentSkip();
+    TestLazyTail();
+    TestMultiEnd();
+    TestNoAllocations();
+    TestBatchStats();
+    TestWorldThreads();
+    TestClosedForm();
+    TestAnalytic();
+    TestRuntimeChain();
+    TestCanonicalPositions();
+    TestSharedDefinition();
+    TestEvaluateTargets();
+    TestRigPackChecks();
+    TestRigRoundTrip();
+    TestScan();
+
+    if(gFailures == 0)
+    {
+        printf("all checks passed\n");
+    }
+    return gFailures;
+}
@@ -5,6 +5,7 @@
 #include <raylib/raymath.h>
 
 #include <fabrik.hpp>
+#include <fabrik_raylib.hpp>
 
 int main()
 {
@@ -33,7 +34,7 @@ int main()
     fabrik.SetIterationLimit(20);
     fabrik.SetIterationThreshold(0.1);
 
-    Vector2 target1;
+    FabrikVec2 target1;
 
     float dir = 1;
 
@@ -42,6 +43,9 @@ int main()
 
     uint32_t effector = effector1;
 
+    FabrikPD2D::EffectorSet effectors;
+    effectors.Add(effector, false);
+
     while(!WindowShouldClose())
     {
         deltaTime = GetTime()-lastTime;
@@ -64,6 +68,8 @@ int main()
             {
                 effector = effector1;
             }
+            effectors.Clear();
+            effectors.Add(effector, false);
         }
 
         Vector2 mousePos = GetMousePosition();
@@ -71,14 +77,14 @@ int main()
 
         if(IsMouseButtonDown(MOUSE_BUTTON_LEFT))
         {
-            target1 = mousePos;
-            fabrik.Solve({effector}, {target1}, {false});
+            target1 = FabrikFromRaylib(mousePos);
+            fabrik.Solve(effectors, &target1, 1);
         }
         
         ClearBackground(BLACK);
         BeginMode2D(cam);
 
-        Vector2 start = fabrik.GetBasePosition();
+        Vector2 start = FabrikToRaylib(fabrik.GetBasePosition());
         float thetaGlobal = fabrik.GetBaseTheta();
         uint32_t curr = fabrik.GetRoot();
         while(curr != 0)
@@ -0,0 +1,104 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fabrik_rig.hpp>
+
+// CONVERTS RIGS BETWEEN THE JSON AUTHORING FORMAT AND A BINARY PACK, THE
+// DIRECTION COMES FROM THE INPUT:
+//
+//     fabrik_rig level.json level.frig
+//     fabrik_rig level.frig level.json
+
+static bool ReadFile(const char* path, std::vector<uint8_t>& data)
+{
+    FILE* file = fopen(path, "rb");
+    if(file == nullptr)
+    {
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    data.resize(size > 0 ? size : 0);
+    bool read = size >= 0 && fread(data.data(), 1, data.size(), file) == data.size();
+    fclose(file);
+    return read;
+}
+
+static bool WriteFile(const char* path, const void* data, size_t size)
+{
+    FILE* file = fopen(path, "wb");
+    if(file == nullptr)
+    {
+        return false;
+    }
+    bool written = fwrite(data, 1, size, file) == size;
+    return fclose(file) == 0 && written;
+}
+
+int main(int argc, char** argv)
+{
+    if(argc != 3)
+    {
+        fprintf(stderr, "usage: %s <rigs.json> <rigs.frig>\n       %s <rigs.frig> <rigs.json>\n", argv[0], argv[0]);
+        return 2;
+    }
+
+    std::vector<uint8_t> input;
+    if(!ReadFile(argv[1], input))
+    {
+        fprintf(stderr, "cannot read %s\n", argv[1]);
+        return 1;
+    }
+
+    std::vector<FabrikPD2D> rigs;
+    FabrikRigPack pack;
+    if(input.size() >= 4 && memcmp(input.data(), "FRIG", 4) == 0)
+    {
+        if(!pack.Open(input.data(), input.size()))
+        {
+            fprintf(stderr, "%s: not a pack this build can read\n", argv[1]);
+            return 1;
+        }
+        rigs.resize(pack.GetRigCount());
+        for(uint32_t r = 0; r < pack.GetRigCount(); r++)
+        {
+            if(!pack.GetRig(r).Load(rigs[r]))
+            {
+                fprintf(stderr, "%s: rig %u is corrupt\n", argv[1], r);
+                return 1;
+            }
+        }
+
+        std::string text;
+        FabrikRigJson::Write(rigs, text);
+        if(!WriteFile(argv[2], text.data(), text.size()))
+        {
+            fprintf(stderr, "cannot write %s\n", argv[2]);
+            return 1;
+        }
+    }
+    else
+    {
+        std::string error;
+        if(!FabrikRigJson::Read(reinterpret_cast<const char*>(input.data()), input.size(), rigs, error))
+        {
+            fprintf(stderr, "%s: %s\n", argv[1], error.c_str());
+            return 1;
+        }
+
+        std::vector<uint8_t> output;
+        FabrikRigPack::Write(rigs, output);
+        if(!WriteFile(argv[2], output.data(), output.size()))
+        {
+            fprintf(stderr, "cannot write %s\n", argv[2]);
+            return 1;
+        }
+    }
+
+    fprintf(stderr, "%u rigs\n", (uint32_t)rigs.size());
+    return 0;
+}